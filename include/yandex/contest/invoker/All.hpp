@@ -4,5 +4,7 @@
 #include <yandex/contest/invoker/ConfigurationError.hpp>
 #include <yandex/contest/invoker/Container.hpp>
 #include <yandex/contest/invoker/ContainerConfig.hpp>
+#include <yandex/contest/invoker/ContainerPool.hpp>
+#include <yandex/contest/invoker/CpuSetAllocator.hpp>
 #include <yandex/contest/invoker/Process.hpp>
 #include <yandex/contest/invoker/ProcessGroup.hpp>
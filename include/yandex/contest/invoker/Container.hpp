@@ -1,7 +1,9 @@
 #pragma once
 
 #include <yandex/contest/invoker/ContainerConfig.hpp>
+#include <yandex/contest/invoker/CpuSetAllocator.hpp>
 #include <yandex/contest/invoker/detail/execution/AsyncProcessGroup.hpp>
+#include <yandex/contest/invoker/detail/execution/ControlProcessDaemon.hpp>
 #include <yandex/contest/invoker/Filesystem.hpp>
 #include <yandex/contest/invoker/filesystem/Config.hpp>
 #include <yandex/contest/invoker/Forward.hpp>
@@ -10,11 +12,18 @@
 
 #include <yandex/contest/IntrusivePointeeBase.hpp>
 
+#include <functional>
+#include <memory>
+#include <vector>
+
 namespace yandex {
 namespace contest {
 namespace invoker {
 
 class Container : public IntrusivePointeeBase {
+ public:
+  using BatchCallback = std::function<void(const ProcessGroupPointer &)>;
+
  public:
   /*!
    * \brief Create new container using specified config.
@@ -69,6 +78,31 @@ class Container : public IntrusivePointeeBase {
    */
   ProcessGroupPointer createProcessGroup();
 
+  /*!
+   * \brief Execute process groups using single control process.
+   *
+   * Process groups should be created by this container
+   * and should not be started.
+   * Results are set as soon as process group is completed,
+   * callback is called for each completed process group.
+   *
+   * \param concurrency Maximum number of process groups
+   * executed simultaneously.
+   *
+   * Cores are allocated before execution for at most concurrency
+   * process groups with exclusive cores, these process groups
+   * take free cores when started and give them back when completed.
+   *
+   * \throws ContainerIllegalStateError if other process group is running.
+   * \throws CpuSetAllocatorExhaustedError
+   * if cores can't be allocated, no process group is executed.
+   * \throws detail::execution::AsyncProcessGroupControlProcessError
+   * if some process groups were not executed, they are left not started.
+   */
+  void executeBatch(const std::vector<ProcessGroupPointer> &processGroups,
+                    std::size_t concurrency = 1,
+                    const BatchCallback &callback = BatchCallback());
+
   /*!
    * \brief Default settings for process group.
    *
@@ -85,6 +119,24 @@ class Container : public IntrusivePointeeBase {
   void setProcessGroupDefaultSettings(
       const process_group::DefaultSettings &processGroupDefaultSettings);
 
+  /*!
+   * \brief Prepare container for the next process group.
+   *
+   * Restore filesystem to the state right after creation
+   * and reset process group default settings to configured ones,
+   * so one container may execute many process groups
+   * without repeated setup.
+   *
+   * Control groups are created for each execution
+   * and are destroyed with it, they do not need to be cleared.
+   * Persistent control process is kept running.
+   *
+   * \throws ContainerIllegalStateError if process group is running.
+   * \throws FilesystemSnapshotIsNotTakenError
+   * if filesystem::Config::snapshot is not set.
+   */
+  void reset();
+
  private:
   friend class ProcessGroup;
 
@@ -101,6 +153,9 @@ class Container : public IntrusivePointeeBase {
   /// \copydoc lxc::Lxc::stop()
   void stop();
 
+  /// Start persistent control process, replacing terminated one.
+  void startControlProcessDaemon();
+
  private:
   /*!
    * \warning Constructor is private because
@@ -115,8 +170,18 @@ class Container : public IntrusivePointeeBase {
  private:
   Filesystem filesystem_;
   const detail::execution::AsyncProcess::Options controlProcessOptions_;
+  const bool persistentControlProcess_;
+  const process_group::DefaultSettings initialProcessGroupDefaultSettings_;
   process_group::DefaultSettings processGroupDefaultSettings_;
+  const CpuSetAllocator &cpuSetAllocator_;
+
+  /// lxc.cgroup.cpuset.cpus, empty if not configured.
+  const std::string cpus_;
   std::unique_ptr<lxc::Lxc> lxcPtr_;
+
+  /// Should be destroyed before lxcPtr_.
+  std::shared_ptr<detail::execution::ControlProcessDaemon>
+      controlProcessDaemon_;
 };
 
 }  // namespace invoker
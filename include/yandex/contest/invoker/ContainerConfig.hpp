@@ -1,14 +1,19 @@
 #pragma once
 
 #include <yandex/contest/invoker/ControlProcessConfig.hpp>
+#include <yandex/contest/invoker/detail/DefaultedNvp.hpp>
 #include <yandex/contest/invoker/filesystem/Config.hpp>
+#include <yandex/contest/invoker/lxc/Backend.hpp>
 #include <yandex/contest/invoker/lxc/Config.hpp>
 #include <yandex/contest/invoker/process_group/DefaultSettings.hpp>
 
+#include <bunsan/serialization/chrono.hpp>
+
 #include <boost/filesystem/path.hpp>
 #include <boost/serialization/access.hpp>
 #include <boost/serialization/nvp.hpp>
 
+#include <chrono>
 #include <iostream>
 
 namespace yandex {
@@ -30,17 +35,43 @@ struct ContainerConfig {
 
     ar & BOOST_SERIALIZATION_NVP(containersDir);
     ar & make_nvp("lxc", lxcConfig);
+    detail::serializeDefaulted(ar, "lxcBackend", lxcBackend);
+    detail::serializeDefaulted(ar, "lxcStopTimeoutSeconds", lxcStopTimeout);
     ar & BOOST_SERIALIZATION_NVP(processGroupDefaultSettings);
     ar & make_nvp("controlProcess", controlProcessConfig);
     ar & make_nvp("filesystem", filesystemConfig);
+    detail::serializeDefaulted(ar, "cpuSetLocksDir", cpuSetLocksDir);
   }
 
   boost::filesystem::path containersDir;
   lxc::Config lxcConfig;
+
+  /*!
+   * \brief Use liblxc or plain namespaces instead of lxc(7) utilities.
+   *
+   * With lxc::Backend::API and lxc::Backend::SANDBOX
+   * control process is always persistent
+   * since it is started by forked child.
+   */
+  lxc::Backend lxcBackend = lxc::Backend::UTILITY;
+
+  /// How long stopped LXC is allowed to reach STOPPED state.
+  std::chrono::seconds lxcStopTimeout{5};
+
   process_group::DefaultSettings processGroupDefaultSettings;
   ControlProcessConfig controlProcessConfig;
   filesystem::Config filesystemConfig;
 
+  /*!
+   * \brief Directory of host-wide core locks.
+   *
+   * Should be the same for every invoker instance on the host.
+   *
+   * \see CpuSetAllocator
+   */
+  boost::filesystem::path cpuSetLocksDir =
+      "/run/lock/yandex_contest_invoker/cpus";
+
   /*!
    * \brief Load ContainerConfig from file specified by INVOKER_CONFIG
    * environment variable. If variable is not specified default instance
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <yandex/contest/invoker/Container.hpp>
+#include <yandex/contest/invoker/ContainerConfig.hpp>
+#include <yandex/contest/invoker/Forward.hpp>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+
+#include <deque>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+
+/*!
+ * \brief Keeps a number of prepared containers ready for use.
+ *
+ * Containers are created and recycled by background thread,
+ * so acquire() does not pay for container setup
+ * unless pool is exhausted.
+ */
+class ContainerPool : private boost::noncopyable {
+ public:
+  /*!
+   * \brief Start background thread that prepares
+   * size containers using specified config.
+   *
+   * Filesystem snapshot is always taken for pooled containers.
+   */
+  ContainerPool(const ContainerConfig &config, std::size_t size);
+
+  /*!
+   * \brief Stop background thread and destroy all pooled containers.
+   */
+  ~ContainerPool();
+
+  /*!
+   * \brief Get prepared container.
+   *
+   * If no container is ready new one is created synchronously.
+   */
+  ContainerPointer acquire();
+
+  /*!
+   * \brief Return container to the pool.
+   *
+   * Container is reset asynchronously and becomes ready again.
+   * If reset fails container is destroyed.
+   *
+   * \see Container::reset()
+   *
+   * \warning Caller should not use container after this call.
+   */
+  void release(const ContainerPointer &container);
+
+  /// Number of containers ready to be acquired.
+  std::size_t ready() const;
+
+ private:
+  /// Background thread routine.
+  void run();
+
+  /// Worker has something to do, should be called under lock.
+  bool hasWork() const;
+
+ private:
+  ContainerConfig config_;
+  const std::size_t size_;
+
+  mutable boost::mutex lock_;
+  boost::condition_variable changed_;
+  std::deque<ContainerPointer> ready_;
+  std::deque<ContainerPointer> released_;
+  bool stopped_ = false;
+  bool failed_ = false;
+
+  boost::thread worker_;
+};
+
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
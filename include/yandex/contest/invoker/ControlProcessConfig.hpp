@@ -1,5 +1,6 @@
 #pragma once
 
+#include <yandex/contest/invoker/detail/DefaultedNvp.hpp>
 #include <yandex/contest/system/execution/AsyncProcess.hpp>
 
 #include <boost/filesystem/path.hpp>
@@ -27,10 +28,19 @@ struct ControlProcessConfig {
   template <typename Archive>
   void serialize(Archive &ar, const unsigned int) {
     ar & BOOST_SERIALIZATION_NVP(executable);
+    detail::serializeDefaulted(ar, "persistent", persistent);
   }
 
   boost::filesystem::path executable;
 
+  /*!
+   * \brief Keep single control process running in container
+   * and send every process group to it.
+   *
+   * \see detail::execution::ControlProcessDaemon
+   */
+  bool persistent = false;
+
   explicit operator system::execution::AsyncProcess::Options() const;
 };
 
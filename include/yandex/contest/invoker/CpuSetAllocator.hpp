@@ -0,0 +1,102 @@
+#pragma once
+
+#include <yandex/contest/invoker/Error.hpp>
+
+#include <yandex/contest/system/unistd/Descriptor.hpp>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+
+struct CpuSetAllocatorError : virtual Error {
+  using cores = boost::error_info<struct coresTag, std::size_t>;
+};
+
+struct CpuSetAllocatorExhaustedError : virtual CpuSetAllocatorError {};
+
+/*!
+ * \brief Hands out exclusive sets of physical cores.
+ *
+ * Allocation is host-wide: each core is owned by flock(2)
+ * on a file in locks directory, so every invoker instance
+ * using the same directory gets disjoint cores.
+ *
+ * Locks are named by physical core id, so hyperthread siblings
+ * are never split between allocations, even if allocations
+ * are restricted to different cpusets: processes pinned
+ * to one allocation do not share execution units
+ * with processes pinned to another.
+ *
+ * CPU topology is read once per process.
+ */
+class CpuSetAllocator : private boost::noncopyable {
+ public:
+  /// Cores are released on destruction.
+  class Allocation : private boost::noncopyable {
+   public:
+    /// CPUs of allocated cores in cpuset(7) list format.
+    const std::string &cpus() const { return cpus_; }
+
+    /// CPUs of first cores of allocated cores in cpuset(7) list format.
+    std::string cpus(std::size_t cores) const;
+
+   private:
+    friend class CpuSetAllocator;
+
+    std::vector<system::unistd::Descriptor> locks_;
+    std::string cpus_;
+
+    /// CPUs of each allocated core.
+    std::vector<std::vector<int>> coreCpus_;
+  };
+
+  using AllocationPointer = std::unique_ptr<Allocation>;
+
+ public:
+  /// Process-wide allocator using specified locks directory.
+  static const CpuSetAllocator &instance(
+      const boost::filesystem::path &locksDir);
+
+  explicit CpuSetAllocator(const boost::filesystem::path &locksDir);
+
+  /// Number of online physical cores.
+  std::size_t cores() const { return cores_.size(); }
+
+  /*!
+   * \brief Lock specified number of cores not owned by anyone else.
+   *
+   * \param allowed CPUs available to container in cpuset(7) list format,
+   * CPUs current process is allowed to run on if empty.
+   * Only allowed CPUs of locked cores are allocated.
+   *
+   * \throws CpuSetAllocatorExhaustedError if there are not enough free cores.
+   */
+  AllocationPointer allocate(std::size_t cores,
+                             const std::string &allowed = std::string()) const;
+
+ private:
+  struct Core {
+    /// Lock file name, derived from physical core id.
+    std::string name;
+
+    /// Online logical CPUs.
+    std::vector<int> cpus;
+  };
+
+  static const std::vector<Core> &topology();
+
+ private:
+  const boost::filesystem::path locksDir_;
+  const std::vector<Core> &cores_;
+};
+
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <yandex/contest/invoker/filesystem/Config.hpp>
+#include <yandex/contest/invoker/filesystem/Snapshot.hpp>
 
 #include <yandex/contest/system/unistd/access/Id.hpp>
 #include <yandex/contest/system/unistd/FileStatus.hpp>
@@ -8,6 +9,8 @@
 #include <boost/filesystem/path.hpp>
 #include <boost/noncopyable.hpp>
 
+#include <memory>
+
 namespace yandex {
 namespace contest {
 namespace invoker {
@@ -22,12 +25,19 @@ struct FilesystemError : virtual Error {
 
 struct FileExistsError : virtual FilesystemError {};
 struct FileDoesNotExistError : virtual FilesystemError {};
+struct FilesystemSnapshotIsNotTakenError : virtual FilesystemError {};
 
 /*!
  * \brief Object implements interface to the container's filesystem.
  */
 class Filesystem : private boost::noncopyable {
  public:
+  /*!
+   * \brief Create requested files and take snapshot of the result
+   * if filesystem::Config::snapshot is set.
+   *
+   * Snapshot storage is placed near containerRoot.
+   */
   Filesystem(const boost::filesystem::path &containerRoot,
              const filesystem::Config &config);
 
@@ -70,10 +80,24 @@ class Filesystem : private boost::noncopyable {
   void pull(const boost::filesystem::path &remote,
             const boost::filesystem::path &local);
 
+  /*!
+   * \brief Restore filesystem to the state right after construction.
+   *
+   * Files created or modified after construction are removed,
+   * removed or modified files are restored.
+   *
+   * \throws FilesystemSnapshotIsNotTakenError
+   * if filesystem::Config::snapshot is not set.
+   *
+   * \warning Container should not be running.
+   */
+  void reset();
+
   ~Filesystem();
 
  private:
   const boost::filesystem::path containerRoot_;
+  std::unique_ptr<filesystem::Snapshot> snapshot_;
 };
 
 }  // namespace invoker
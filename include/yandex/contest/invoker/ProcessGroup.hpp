@@ -1,6 +1,7 @@
 #pragma once
 
 #include <yandex/contest/invoker/ContainerError.hpp>
+#include <yandex/contest/invoker/CpuSetAllocator.hpp>
 #include <yandex/contest/invoker/Forward.hpp>
 #include <yandex/contest/invoker/detail/CommonProcessTypedefs.hpp>
 #include <yandex/contest/invoker/detail/execution/AsyncProcessGroup.hpp>
@@ -69,6 +70,8 @@ class ProcessGroup : public IntrusivePointeeBase {
    *
    * \throws ProcessGroupIllegalStateError
    * if any other process group is running.
+   * \throws CpuSetAllocatorExhaustedError
+   * if exclusive cores can't be allocated.
    */
   void start();
 
@@ -141,6 +144,19 @@ class ProcessGroup : public IntrusivePointeeBase {
   const ResourceLimits &resourceLimits() const;
   void setResourceLimits(const ResourceLimits &resourceLimits);
 
+  /*!
+   * \brief Whether processes are started in parallel.
+   *
+   * Control groups and descriptors are prepared concurrently
+   * and processes are released simultaneously right before exec,
+   * so start time of the last process does not depend
+   * on number of processes.
+   *
+   * Disabled by default, processes are started one by one.
+   */
+  bool parallelStart() const;
+  void setParallelStart(bool parallelStart);
+
   /*!
    * \brief Process with other pipe end will receive
    * notifications that can be accessed by Notifier.
@@ -189,11 +205,15 @@ class ProcessGroup : public IntrusivePointeeBase {
    */
   explicit ProcessGroup(const ContainerPointer &container);
 
+  friend class Container;
   friend class Process;
 
   ProcessTask &processTask(std::size_t id);
   const process::Result &processResult(std::size_t id);
 
+  /// Pin task to exclusive cores if they are requested.
+  void allocateCores();
+
  private:
   /// If pointer is null process group has terminated.
   ContainerPointer container_;
@@ -202,6 +222,9 @@ class ProcessGroup : public IntrusivePointeeBase {
   detail::execution::AsyncProcessGroup::Task task_;
   boost::optional<detail::execution::AsyncProcessGroup::Result> result_;
   process::DefaultSettings processDefaultSettings_;
+
+  /// Released as soon as process group has terminated.
+  CpuSetAllocator::AllocationPointer cores_;
 };
 
 }  // namespace invoker
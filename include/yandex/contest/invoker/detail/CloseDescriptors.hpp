@@ -0,0 +1,25 @@
+#pragma once
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+
+/*!
+ * \brief Close descriptors above standard streams except keep.
+ *
+ * Async-signal-safe, suitable for forked child
+ * of multithreaded process.
+ *
+ * \param keep is not closed if it is not negative.
+ * \param maxFd limits descriptors closed one by one
+ * if close_range(2) is not supported, see getdtablesize(2).
+ *
+ * \return false on failure.
+ */
+bool closeDescriptors(int keep, unsigned maxFd) noexcept;
+
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+
+/// CPU numbers from cpuset(7) list format, e.g. "0-3,8".
+std::vector<int> parseCpuList(const std::string &cpus);
+
+/// CPU numbers in cpuset(7) list format, ranges are not merged.
+std::string formatCpuList(const std::vector<int> &cpus);
+
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
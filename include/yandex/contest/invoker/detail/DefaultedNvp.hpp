@@ -0,0 +1,29 @@
+#pragma once
+
+#include <boost/optional.hpp>
+#include <boost/serialization/nvp.hpp>
+#include <boost/serialization/optional.hpp>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+
+/*!
+ * \brief Serialize value under name, keep current value
+ * if archive does not have that name.
+ *
+ * Configurations written before the key was introduced
+ * are loaded with member's default.
+ */
+template <typename Archive, typename T>
+void serializeDefaulted(Archive &ar, const char *const name, T &value) {
+  boost::optional<T> optionalValue = value;
+  ar & boost::serialization::make_nvp(name, optionalValue);
+  if (optionalValue) value = *optionalValue;
+}
+
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
@@ -7,6 +7,9 @@
 #include <yandex/contest/system/execution/AsyncProcess.hpp>
 #include <yandex/contest/system/execution/ResultError.hpp>
 
+#include <functional>
+#include <memory>
+
 namespace yandex {
 namespace contest {
 namespace invoker {
@@ -22,6 +25,8 @@ struct AsyncProcessGroupControlProcessError : ContainerUtilityError,
   using ContainerUtilityError::ContainerUtilityError;
 };
 
+class ControlProcessDaemon;
+
 class AsyncProcessGroup {
  public:
   using AccessMode = async_process_group_detail::AccessMode;
@@ -35,6 +40,9 @@ class AsyncProcessGroup {
   using NonPipeStream = async_process_group_detail::NonPipeStream;
   using Task = async_process_group_detail::Task;
   using Result = async_process_group_detail::Result;
+  using BatchTask = async_process_group_detail::BatchTask;
+  using BatchResult = async_process_group_detail::BatchResult;
+  using BatchCallback = std::function<void(const BatchResult &)>;
 
  public:
   /// Invalid AsyncProcessGroup instance.
@@ -48,6 +56,21 @@ class AsyncProcessGroup {
    * \param task Process group settings.
    */
   AsyncProcessGroup(const AsyncProcess::Options &options, const Task &task);
+
+  /*!
+   * \brief Start new asynchronous group using
+   * already running control process.
+   *
+   * \param daemon Should not be busy.
+   *
+   * \see ControlProcessDaemon
+   */
+  AsyncProcessGroup(const std::shared_ptr<ControlProcessDaemon> &daemon,
+                    const Task &task);
+
+  /// Already completed process group.
+  explicit AsyncProcessGroup(const Result &result);
+
   AsyncProcessGroup(const AsyncProcessGroup &) = delete;
   AsyncProcessGroup(AsyncProcessGroup &&);
   AsyncProcessGroup &operator=(const AsyncProcessGroup &) = delete;
@@ -91,11 +114,35 @@ class AsyncProcessGroup {
    */
   static Result execute(const Task &task);
 
+  /*!
+   * \brief Execute tasks calling callback for each result
+   * in order of completion.
+   *
+   * Tasks are executed by forked control processes
+   * if BatchTask::concurrency is greater than 1.
+   *
+   * \copydetails execute()
+   */
+  static void execute(const BatchTask &batch, const BatchCallback &callback);
+
+  /*!
+   * \brief Persistent control process implementation.
+   *
+   * Execute tasks read from in and write results to out
+   * until in is closed.
+   *
+   * \copydetails execute()
+   *
+   * \see ControlProcessDaemon
+   */
+  static void serve(int in, int out);
+
  private:
   void readResult();
 
  private:
   AsyncProcess controlProcess_;
+  std::shared_ptr<ControlProcessDaemon> daemon_;
   boost::optional<Result> result_;
 };
 
@@ -16,6 +16,8 @@
 #include <boost/serialization/access.hpp>
 #include <boost/serialization/map.hpp>
 #include <boost/serialization/nvp.hpp>
+#include <boost/serialization/optional.hpp>
+#include <boost/serialization/string.hpp>
 #include <bunsan/serialization/path.hpp>
 #include <bunsan/serialization/unordered_map.hpp>
 #include <boost/serialization/variant.hpp>
@@ -23,6 +25,7 @@
 #include <boost/variant.hpp>
 
 #include <iostream>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -169,6 +172,8 @@ struct Task {
     ar & BOOST_SERIALIZATION_NVP(pipesNumber);
     ar & BOOST_SERIALIZATION_NVP(notifiers);
     ar & BOOST_SERIALIZATION_NVP(resourceLimits);
+    ar & BOOST_SERIALIZATION_NVP(parallelStart);
+    ar & BOOST_SERIALIZATION_NVP(cpus);
   }
 
   std::vector<Process> processes;
@@ -180,6 +185,19 @@ struct Task {
   std::vector<NotificationStream> notifiers;
 
   process_group::ResourceLimits resourceLimits;
+
+  /*!
+   * \brief Prepare processes concurrently
+   * and release them simultaneously.
+   */
+  bool parallelStart = false;
+
+  /*!
+   * \brief CPUs processes are pinned to in cpuset(7) list format.
+   *
+   * Empty means CPUs of control process.
+   */
+  std::string cpus;
 };
 
 std::istream &operator>>(std::istream &in, Task &task);
@@ -198,6 +216,55 @@ struct Result {
   process_group::Result processGroupResult;
 };
 
+/// Tasks executed by a single control process.
+struct BatchTask {
+  friend class boost::serialization::access;
+
+  template <typename Archive>
+  void serialize(Archive &ar, const unsigned int) {
+    ar & BOOST_SERIALIZATION_NVP(tasks);
+    ar & BOOST_SERIALIZATION_NVP(concurrency);
+    ar & BOOST_SERIALIZATION_NVP(exclusiveCores);
+  }
+
+  std::vector<Task> tasks;
+
+  /// Maximum number of tasks executed simultaneously.
+  std::size_t concurrency = 1;
+
+  /*!
+   * \brief Sets of exclusive cores shared by tasks requesting them.
+   *
+   * Task with non-zero exclusiveCores limit is pinned to a free set
+   * when it is started, the set is free again when task completes.
+   * There are at most concurrency sets.
+   *
+   * Item i of a set lists CPUs of its first i + 1 cores
+   * in cpuset(7) list format.
+   */
+  std::vector<std::vector<std::string>> exclusiveCores;
+};
+
+struct BatchResult {
+  friend class boost::serialization::access;
+
+  template <typename Archive>
+  void serialize(Archive &ar, const unsigned int) {
+    ar & BOOST_SERIALIZATION_NVP(id);
+    ar & BOOST_SERIALIZATION_NVP(result);
+    ar & BOOST_SERIALIZATION_NVP(error);
+  }
+
+  /// Index of task in BatchTask::tasks.
+  std::size_t id = 0;
+
+  /// Not initialized if task was not executed.
+  boost::optional<Result> result;
+
+  /// Reason why task was not executed.
+  std::string error;
+};
+
 }  // namespace async_process_group_detail
 }  // namespace execution
 }  // namespace detail
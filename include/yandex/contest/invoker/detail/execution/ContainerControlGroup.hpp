@@ -0,0 +1,57 @@
+#pragma once
+
+#include <boost/filesystem/path.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+
+/*!
+ * \brief Control group of the whole container.
+ *
+ * Created as a child of control group of current process
+ * in the same hierarchy process groups use, removed on destruction.
+ *
+ * \see lxc::Sandbox
+ */
+class ContainerControlGroup : private boost::noncopyable {
+ public:
+  explicit ContainerControlGroup(const std::string &name);
+
+  /// Terminates processes and removes control group.
+  ~ContainerControlGroup();
+
+  /// Files process should write "0" to in order to attach itself.
+  std::vector<boost::filesystem::path> attachFiles() const;
+
+  /// Kill every process and wait until control group is empty.
+  void terminate();
+
+  /// Stop every process in control group until unfreeze().
+  void freeze();
+  void unfreeze();
+
+  /// Write raw control file, e.g. "memory.limit_in_bytes".
+  void writeField(const std::string &field, const std::string &value);
+
+  friend std::ostream &operator<<(std::ostream &out,
+                                  const ContainerControlGroup &controlGroup);
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> pimpl;
+};
+
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
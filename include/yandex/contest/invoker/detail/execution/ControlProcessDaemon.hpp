@@ -0,0 +1,183 @@
+#pragma once
+
+#include <yandex/contest/invoker/detail/execution/AsyncProcessGroupDetail.hpp>
+
+#include <yandex/contest/system/execution/AsyncProcess.hpp>
+#include <yandex/contest/system/execution/Result.hpp>
+#include <yandex/contest/system/unistd/Descriptor.hpp>
+
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+
+#include <functional>
+#include <string>
+
+#include <sys/types.h>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+
+/*!
+ * \brief Long-lived control process executing stream of tasks.
+ *
+ * Control process is started once, tasks and results
+ * are transferred over a socket connected to its stdin and stdout.
+ * Control process exits when socket is closed.
+ *
+ * \see AsyncProcessGroup::serve()
+ */
+class ControlProcessDaemon : private boost::noncopyable {
+ public:
+  using Task = async_process_group_detail::Task;
+  using Result = async_process_group_detail::Result;
+  using BatchTask = async_process_group_detail::BatchTask;
+  using BatchResult = async_process_group_detail::BatchResult;
+
+  /*!
+   * \brief Start control process and return its pid.
+   *
+   * Started process should call setUp() before exec
+   * and should be a child of calling process.
+   */
+  using Spawner =
+      std::function<pid_t(const std::function<void()> &setUp)>;
+
+  /*!
+   * \brief Terminate processes started by control process.
+   *
+   * Killed control process does not kill its tasks,
+   * e.g. terminator may stop the container.
+   */
+  using Terminator = std::function<void()>;
+
+ public:
+  /// Start control process, options should enable persistent mode.
+  explicit ControlProcessDaemon(
+      const system::execution::AsyncProcess::Options &options,
+      const Terminator &terminator = Terminator());
+
+  /// Start control process using custom spawner.
+  explicit ControlProcessDaemon(const Spawner &spawner,
+                                const Terminator &terminator = Terminator());
+
+  /// Calls close().
+  ~ControlProcessDaemon();
+
+  /// Control process was not terminated.
+  bool running() const;
+
+  /// Task was sent but result was not received yet.
+  bool busy() const;
+
+  /// Number of batch results that were not received yet.
+  std::size_t pending() const;
+
+  /*!
+   * \brief Send task to control process.
+   *
+   * \warning Should not be called while busy().
+   */
+  void start(const Task &task);
+
+  /*!
+   * \brief Check if current task has completed.
+   *
+   * \throws AsyncProcessGroupControlProcessError
+   * if control process has failed or task was not started.
+   */
+  boost::optional<Result> poll();
+
+  /*!
+   * \brief Wait for current task completion.
+   *
+   * \copydetails poll()
+   */
+  Result wait();
+
+  /*!
+   * \brief Send batch to control process.
+   *
+   * Control process is busy() until pending() becomes 0.
+   *
+   * \warning Should not be called while busy().
+   */
+  void start(const BatchTask &batch);
+
+  /*!
+   * \brief Get next batch result if available.
+   *
+   * Results are received in order of completion.
+   *
+   * \copydetails poll()
+   */
+  boost::optional<BatchResult> pollBatch();
+
+  /*!
+   * \brief Wait for next batch result.
+   *
+   * \copydetails pollBatch()
+   *
+   * If control process has failed to execute the batch,
+   * remaining results are dropped and exception is thrown.
+   */
+  BatchResult waitBatch();
+
+  /// Call terminator if any and kill control process.
+  void stop();
+
+  /// Let control process exit and wait for it.
+  void close();
+
+ public:
+  /*!
+   * \brief Control process side: execute tasks and batches read from in
+   * and write results to out until in is closed.
+   */
+  static void serve(int in, int out);
+
+ private:
+  /// Send request frame of specified type.
+  void send(char type, const std::string &payload);
+
+  /// Read available data, return false on EOF.
+  bool receive(bool block);
+
+  /// Extract complete frame from buffer_.
+  bool extractFrame(char &type, std::string &payload);
+
+  /*!
+   * \brief Get next frame.
+   *
+   * \return false if frame is not available and block is false.
+   */
+  bool nextFrame(bool block, char &type, std::string &payload);
+
+  Result toResult(char type, const std::string &payload);
+  BatchResult toBatchResult(char type, const std::string &payload);
+
+  /// Wait for control process termination and throw.
+  [[noreturn]] void fail(const std::string &reason);
+
+  /// Throw error about missing task.
+  [[noreturn]] void noTask();
+
+  /// Wait for control process termination.
+  system::execution::Result reap();
+
+ private:
+  pid_t pid_ = -1;
+  Terminator terminator_;
+  system::unistd::Descriptor socket_;
+  std::string buffer_;
+  bool busy_ = false;
+  std::size_t pending_ = 0;
+};
+
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
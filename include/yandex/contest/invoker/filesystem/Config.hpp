@@ -1,5 +1,6 @@
 #pragma once
 
+#include <yandex/contest/invoker/detail/DefaultedNvp.hpp>
 #include <yandex/contest/invoker/filesystem/CreateFile.hpp>
 
 #include <boost/serialization/access.hpp>
@@ -18,9 +19,20 @@ struct Config {
   template <typename Archive>
   void serialize(Archive &ar, const unsigned int) {
     ar & BOOST_SERIALIZATION_NVP(createFiles);
+    detail::serializeDefaulted(ar, "snapshot", snapshot);
   }
 
   CreateFiles createFiles;
+
+  /*!
+   * \brief Copy container root after files are created,
+   * so Filesystem::reset() can restore it.
+   *
+   * Copy is as large as root itself, it is not taken by default.
+   *
+   * \see ContainerPool
+   */
+  bool snapshot = false;
 };
 
 }  // namespace filesystem
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <boost/filesystem/path.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <map>
+#include <vector>
+
+#include <sys/stat.h>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace filesystem {
+
+/*!
+ * \brief Baseline state of directory tree that can be restored later.
+ *
+ * Metadata of every entry is recorded,
+ * contents of non-empty regular files are copied into storage.
+ * Restoration removes new entries and recreates
+ * only entries that were changed or removed.
+ */
+class Snapshot : private boost::noncopyable {
+ public:
+  /*!
+   * \brief Record current state of root.
+   *
+   * \param storage non-existent directory for file contents,
+   * should not be inside root.
+   */
+  Snapshot(const boost::filesystem::path &root,
+           const boost::filesystem::path &storage);
+
+  /// Restore root to recorded state.
+  void restore();
+
+ private:
+  struct Entry {
+    struct ::stat status;
+    boost::filesystem::path symlinkValue;
+  };
+
+  /// Create entry at root / path, update recorded status.
+  void create(const boost::filesystem::path &path, Entry &entry);
+
+  /// Set ownership and permissions of root / path.
+  void setAttributes(const boost::filesystem::path &path, const Entry &entry);
+
+ private:
+  const boost::filesystem::path root_;
+  const boost::filesystem::path storage_;
+
+  /// Paths are relative to root, parent precedes children.
+  std::map<boost::filesystem::path, Entry> entries_;
+};
+
+}  // namespace filesystem
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
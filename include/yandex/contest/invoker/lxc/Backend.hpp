@@ -0,0 +1,28 @@
+#pragma once
+
+#include <bunsan/stream_enum.hpp>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace lxc {
+
+/*!
+ * \brief How LXC lifecycle operations are performed.
+ *
+ * UTILITY runs lxc-execute(1), lxc-stop(1), lxc-freeze(1)
+ * and lxc-unfreeze(1), API calls liblxc directly,
+ * SANDBOX does not use LXC at all.
+ *
+ * \see Sandbox
+ */
+BUNSAN_STREAM_ENUM_CLASS(Backend, (
+  UTILITY,
+  API,
+  SANDBOX
+))
+
+}  // namespace lxc
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <yandex/contest/invoker/lxc/Backend.hpp>
 #include <yandex/contest/invoker/lxc/Config.hpp>
 #include <yandex/contest/invoker/lxc/Error.hpp>
 #include <yandex/contest/invoker/lxc/LxcApi.hpp>
+#include <yandex/contest/invoker/lxc/Sandbox.hpp>
 #include <yandex/contest/invoker/lxc/State.hpp>
 
 #include <yandex/contest/system/execution/AsyncProcess.hpp>
@@ -15,6 +17,8 @@
 
 #include <atomic>
 #include <chrono>
+#include <functional>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -30,7 +34,10 @@ class Lxc : private boost::noncopyable {
 
  public:
   Lxc(const std::string &name, const boost::filesystem::path &dir,
-      const Config &settings);
+      const Config &settings, Backend backend = Backend::UTILITY,
+      std::chrono::seconds stopTimeout = std::chrono::seconds(5));
+
+  Backend backend() const;
 
   void freeze();
   void unfreeze();
@@ -48,13 +55,38 @@ class Lxc : private boost::noncopyable {
     return result;
   }
 
-  /// \todo Is not implemented.
-  // void start(const ProcessArguments &arguments);
+  /*!
+   * \brief Start application container using liblxc or Sandbox.
+   *
+   * Container is started from forked child process
+   * which terminates when container stops,
+   * child's exit status is application's exit status.
+   * Standard streams are inherited by the application,
+   * other descriptors are closed.
+   *
+   * \param setUp is called in child process before container start,
+   * e.g. to redirect standard streams. It is called in forked child
+   * of possibly multithreaded process, so it should not allocate.
+   *
+   * \return Pid of child process.
+   */
+  pid_t start(const system::execution::ProcessArguments &arguments,
+              const std::function<void()> &setUp);
 
   /// \todo Is not implemented.
   // void start();
 
-  /// Kill all processes running in container.
+  /*!
+   * \brief Kill all processes running in container.
+   *
+   * If container is being started, waits for it to start first,
+   * but not longer than 200 milliseconds since the start:
+   * container of completed process is never seen running.
+   * Returns when container is stopped.
+   *
+   * \throws IllegalStateError if container is not stopped
+   * in stop timeout.
+   */
   void stop();
 
   /// Container's state.
@@ -72,6 +104,25 @@ class Lxc : private boost::noncopyable {
   void execute_(const Executor &executor,
                 const system::execution::AsyncProcess::Options &options);
 
+  /// Ensure that LXC is stopped and remember start time.
+  void beforeStart();
+
+  /*!
+   * \brief Wait for container to reach one of states.
+   *
+   * \param states State names separated by '|'.
+   *
+   * \return false on timeout.
+   */
+  bool wait(const std::string &states, std::chrono::seconds timeout);
+
+  /*!
+   * \brief Kill all processes running in container.
+   *
+   * \return false if LXC is not running.
+   */
+  bool tryStop();
+
   void prepare(Config &config);
   void prepare(system::unistd::MountEntry &entry);
 
@@ -87,8 +138,14 @@ class Lxc : private boost::noncopyable {
   const boost::filesystem::path rootfs_;
   const boost::filesystem::path rootfsMount_;
   const boost::filesystem::path configPath_;
+  const Backend backend_;
+  const std::chrono::seconds stopTimeout_;
   api::container_ptr container_;
+  std::unique_ptr<Sandbox> sandbox_;
   std::atomic<Clock::time_point> lastStart_;
+
+  /// Container was started but was not seen running yet.
+  std::atomic<bool> starting_;
 };
 
 }  // namespace lxc
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <yandex/contest/invoker/detail/execution/ContainerControlGroup.hpp>
+#include <yandex/contest/invoker/lxc/Config.hpp>
+#include <yandex/contest/invoker/lxc/State.hpp>
+
+#include <yandex/contest/system/execution/AsyncProcess.hpp>
+#include <yandex/contest/system/unistd/Descriptor.hpp>
+
+#include <boost/noncopyable.hpp>
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+
+namespace lxc {
+
+/*!
+ * \brief Application container built from Linux namespaces directly.
+ *
+ * Mount, pid, uts, ipc and net namespaces are created by unshare(2),
+ * mount entries are mounted, rootfs is pivoted, hostname is set
+ * and Config::cap_drop capabilities are dropped according to Config.
+ * Container is placed into own control group with Config::cgroup values.
+ *
+ * Init process reaps orphans and exits with application's status,
+ * the whole container terminates with it.
+ * Descriptors of caller except standard streams are not inherited.
+ *
+ * Network namespace is always empty and there is no console,
+ * so only network entries of "empty" type and "none" console are allowed.
+ */
+class Sandbox : private boost::noncopyable {
+ public:
+  using State = lxc_detail::State;
+
+ public:
+  /*!
+   * \param config Should be prepared by Lxc:
+   * rootfs is set and mount entries point inside rootfs.
+   *
+   * \throws ConfigError if config can't be honoured.
+   */
+  Sandbox(const std::string &name, const Config &config);
+
+  /// Terminate processes and remove control group.
+  ~Sandbox();
+
+  /*!
+   * \brief Start application in new namespaces.
+   *
+   * \param setUp is called in container's control group
+   * before namespaces are created. It is called in forked child
+   * of possibly multithreaded process, so it should not allocate.
+   *
+   * \return Pid of container's supervisor in caller's pid namespace.
+   * Caller should reap it, exit status is application's exit status.
+   *
+   * \warning Should not be called while running.
+   */
+  pid_t start(const system::execution::ProcessArguments &arguments,
+              const std::function<void()> &setUp);
+
+  State state() const;
+
+  void freeze();
+  void unfreeze();
+
+  /*!
+   * \brief Kill every process in container's control group.
+   *
+   * \return false if container is not running.
+   */
+  bool stop();
+
+  /*!
+   * \brief Wait for supervisor termination.
+   *
+   * \return false on timeout.
+   */
+  bool wait(std::chrono::milliseconds timeout) const;
+
+ private:
+  bool running() const;
+
+ private:
+  const std::string name_;
+  const Config config_;
+  detail::execution::ContainerControlGroup controlGroup_;
+
+  /// Capability numbers, validated on construction.
+  std::vector<int> capDrop_;
+
+  /// Supervisor of the last started container.
+  pid_t pid_ = -1;
+
+  /// Read end of a pipe, hung up when supervisor exits.
+  system::unistd::Descriptor exitFd_;
+  bool frozen_ = false;
+};
+
+}  // namespace lxc
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
@@ -1,11 +1,16 @@
 #pragma once
 
+#include <yandex/contest/invoker/detail/DefaultedNvp.hpp>
+
 #include <boost/serialization/access.hpp>
 #include <bunsan/serialization/chrono.hpp>
+#include <bunsan/stream_enum.hpp>
 #include <boost/serialization/nvp.hpp>
 
 #include <chrono>
 
+#include <limits>
+
 #include <cstdint>
 
 namespace yandex {
@@ -20,19 +25,94 @@ struct ResourceLimits {
     ar & make_nvp("timeLimitNanos", timeLimit);
     ar & make_nvp("userTimeLimitMillis", userTimeLimit);
     ar & make_nvp("systemTimeLimitMillis", systemTimeLimit);
+    detail::serializeDefaulted(ar, "realTimeLimitMillis", realTimeLimit);
+    detail::serializeDefaulted(ar, "idleTimeLimitMillis", idleTimeLimit);
+    detail::serializeDefaulted(ar, "idleCpuUsageRatio", idleCpuUsageRatio);
     ar & BOOST_SERIALIZATION_NVP(memoryLimitBytes);
+    detail::serializeDefaulted(ar, "memoryCharge", memoryCharge);
     ar & BOOST_SERIALIZATION_NVP(outputLimitBytes);
     ar & BOOST_SERIALIZATION_NVP(numberOfProcesses);
+    detail::serializeDefaulted(ar, "countHardwareEvents", countHardwareEvents);
+    detail::serializeDefaulted(ar, "instructionLimit", instructionLimit);
+    detail::serializeDefaulted(ar, "ioReadBytesPerSecond",
+                               ioReadBytesPerSecond);
+    detail::serializeDefaulted(ar, "ioWriteBytesPerSecond",
+                               ioWriteBytesPerSecond);
+    detail::serializeDefaulted(ar, "ioReadOperationsPerSecond",
+                               ioReadOperationsPerSecond);
+    detail::serializeDefaulted(ar, "ioWriteOperationsPerSecond",
+                               ioWriteOperationsPerSecond);
   }
 
   std::chrono::nanoseconds timeLimit = std::chrono::seconds(2);
   std::chrono::milliseconds userTimeLimit = std::chrono::hours(1);
   std::chrono::milliseconds systemTimeLimit = std::chrono::hours(1);
+
+  /// Wall time since process start, independent of process group limit.
+  std::chrono::milliseconds realTimeLimit = std::chrono::hours(1);
+
+  /*!
+   * \brief Wall time process may stay idle.
+   *
+   * Process is idle while its CPU time grows slower
+   * than idleCpuUsageRatio of wall time,
+   * e.g. when it is blocked on read(2).
+   */
+  std::chrono::milliseconds idleTimeLimit = std::chrono::hours(1);
+  double idleCpuUsageRatio = 0.01;
+
+  /*!
+   * \brief Memory charged against memoryLimitBytes.
+   *
+   * - RESIDENT: sampled anonymous memory, page cache is not charged.
+   * - PEAK: kernel-maintained maximum, includes page cache
+   *   (e.g. tmpfs files) and kernel memory, short spikes are not missed.
+   * - PEAK_WITH_SWAP: PEAK including swap.
+   */
+  BUNSAN_INCLASS_STREAM_ENUM_CLASS(MemoryCharge, (
+    RESIDENT,
+    PEAK,
+    PEAK_WITH_SWAP
+  ))
+
   std::uint64_t memoryLimitBytes = 256 * 1024 * 1024;  // 256 MiB
   std::uint64_t outputLimitBytes = 2 * 1024 * 1024;    // 2 MiB
+  MemoryCharge memoryCharge = MemoryCharge::RESIDENT;
 
   /// Number of threads (RLIMIT_NPROC) for process real user id.
   std::uint64_t numberOfProcesses = 32;
+
+  /*!
+   * \brief Count hardware events using perf_event_open(2).
+   *
+   * Enabled implicitly by instructionLimit.
+   * Requires cgroup v2 unified hierarchy.
+   */
+  bool countHardwareEvents = false;
+
+  /*!
+   * \brief Instructions retired in user space, independent of system load.
+   *
+   * If instructions were not counted completely,
+   * e.g. counter was not scheduled on PMU, there is no verdict:
+   * process is terminated and process group fails with an error.
+   */
+  std::uint64_t instructionLimit = std::numeric_limits<std::uint64_t>::max();
+
+  /*!
+   * \brief Block I/O throttling applied to each disk.
+   *
+   * Maximum value means unlimited.
+   * Requires cgroup v2 unified hierarchy.
+   */
+  std::uint64_t ioReadBytesPerSecond =
+      std::numeric_limits<std::uint64_t>::max();
+  std::uint64_t ioWriteBytesPerSecond =
+      std::numeric_limits<std::uint64_t>::max();
+  std::uint64_t ioReadOperationsPerSecond =
+      std::numeric_limits<std::uint64_t>::max();
+  std::uint64_t ioWriteOperationsPerSecond =
+      std::numeric_limits<std::uint64_t>::max();
 };
 
 }  // namespace process
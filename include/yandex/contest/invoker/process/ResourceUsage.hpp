@@ -2,7 +2,9 @@
 
 #include <boost/serialization/access.hpp>
 #include <bunsan/serialization/chrono.hpp>
+#include <boost/optional.hpp>
 #include <boost/serialization/nvp.hpp>
+#include <boost/serialization/optional.hpp>
 
 #include <chrono>
 
@@ -20,7 +22,30 @@ struct ResourceUsage {
     ar & make_nvp("timeUsageNanos", timeUsage);
     ar & make_nvp("userTimeUsageMillis", userTimeUsage);
     ar & make_nvp("systemTimeUsageMillis", systemTimeUsage);
+    ar & make_nvp("realTimeUsageNanos", realTimeUsage);
+    ar & BOOST_SERIALIZATION_NVP(instructions);
+    ar & BOOST_SERIALIZATION_NVP(cycles);
+    ar & BOOST_SERIALIZATION_NVP(cacheMisses);
+    ar & make_nvp("cpuSomeStallTimeMicros", cpuSomeStallTime);
+    ar & make_nvp("memorySomeStallTimeMicros", memorySomeStallTime);
+    ar & make_nvp("memoryFullStallTimeMicros", memoryFullStallTime);
+    ar & make_nvp("ioSomeStallTimeMicros", ioSomeStallTime);
+    ar & make_nvp("ioFullStallTimeMicros", ioFullStallTime);
+    ar & BOOST_SERIALIZATION_NVP(throttledPeriods);
+    ar & make_nvp("throttledTimeMicros", throttledTime);
+    ar & BOOST_SERIALIZATION_NVP(ioReadBytes);
+    ar & BOOST_SERIALIZATION_NVP(ioWriteBytes);
+    ar & BOOST_SERIALIZATION_NVP(ioReadOperations);
+    ar & BOOST_SERIALIZATION_NVP(ioWriteOperations);
     ar & BOOST_SERIALIZATION_NVP(memoryUsageBytes);
+    ar & BOOST_SERIALIZATION_NVP(anonymousMemoryBytes);
+    ar & BOOST_SERIALIZATION_NVP(pageCacheBytes);
+    ar & BOOST_SERIALIZATION_NVP(sharedMemoryBytes);
+    ar & BOOST_SERIALIZATION_NVP(kernelMemoryBytes);
+    ar & BOOST_SERIALIZATION_NVP(swapBytes);
+    ar & BOOST_SERIALIZATION_NVP(peakMemoryBytes);
+    ar & BOOST_SERIALIZATION_NVP(peakMemorySwapBytes);
+    ar & BOOST_SERIALIZATION_NVP(oomKills);
   }
 
   ResourceUsage() = default;
@@ -30,7 +55,67 @@ struct ResourceUsage {
   std::chrono::nanoseconds timeUsage;
   std::chrono::milliseconds userTimeUsage;
   std::chrono::milliseconds systemTimeUsage;
+  std::chrono::nanoseconds realTimeUsage{0};
+  /// Charged memory, see ResourceLimits::memoryCharge.
   std::uint64_t memoryUsageBytes = 0;
+
+  /// Memory usage breakdown, maximum of samples.
+  std::uint64_t anonymousMemoryBytes = 0;
+  std::uint64_t pageCacheBytes = 0;
+
+  /// Shared memory and tmpfs files, part of page cache.
+  std::uint64_t sharedMemoryBytes = 0;
+  std::uint64_t kernelMemoryBytes = 0;
+  std::uint64_t swapBytes = 0;
+
+  /*!
+   * \brief Kernel-maintained maximum including page cache.
+   *
+   * Not set if kernel does not maintain it (cgroup v2 before Linux 5.19).
+   */
+  boost::optional<std::uint64_t> peakMemoryBytes;
+
+  /// Not set if swap is not accounted.
+  boost::optional<std::uint64_t> peakMemorySwapBytes;
+
+  /// Processes killed by oom-killer on memory limit.
+  std::uint64_t oomKills = 0;
+
+  /*!
+   * \brief Hardware events counted in user space.
+   *
+   * Not set if counting is disabled or not supported
+   * or if counter was multiplexed and has missed events.
+   *
+   * \see ResourceLimits::countHardwareEvents
+   */
+  boost::optional<std::uint64_t> instructions;
+  boost::optional<std::uint64_t> cycles;
+  boost::optional<std::uint64_t> cacheMisses;
+
+  /*!
+   * \brief Wall time tasks were stalled waiting for resource.
+   *
+   * Taken from pressure stall information:
+   * "some" means at least one task was stalled,
+   * "full" means all non-idle tasks were stalled.
+   * Not set if pressure stall information is not available.
+   */
+  boost::optional<std::chrono::microseconds> cpuSomeStallTime;
+  boost::optional<std::chrono::microseconds> memorySomeStallTime;
+  boost::optional<std::chrono::microseconds> memoryFullStallTime;
+  boost::optional<std::chrono::microseconds> ioSomeStallTime;
+  boost::optional<std::chrono::microseconds> ioFullStallTime;
+
+  /// CPU bandwidth control throttling, not set if not available.
+  boost::optional<std::uint64_t> throttledPeriods;
+  boost::optional<std::chrono::microseconds> throttledTime;
+
+  /// Block I/O summed over devices, not set if not available.
+  boost::optional<std::uint64_t> ioReadBytes;
+  boost::optional<std::uint64_t> ioWriteBytes;
+  boost::optional<std::uint64_t> ioReadOperations;
+  boost::optional<std::uint64_t> ioWriteOperations;
 };
 
 }  // namespace process
@@ -47,7 +47,10 @@ struct Result : system::unistd::ProcessResult {
     SYSTEM_TIME_LIMIT_EXCEEDED,
     OUTPUT_LIMIT_EXCEEDED,
     START_FAILED,
-    STOPPED
+    STOPPED,
+    REAL_TIME_LIMIT_EXCEEDED,
+    IDLE_TIME_LIMIT_EXCEEDED,
+    INSTRUCTION_LIMIT_EXCEEDED
   ))
 
   CompletionStatus completionStatus = CompletionStatus::OK;
@@ -1,11 +1,15 @@
 #pragma once
 
+#include <yandex/contest/invoker/detail/DefaultedNvp.hpp>
+
 #include <boost/serialization/access.hpp>
 #include <bunsan/serialization/chrono.hpp>
 #include <boost/serialization/nvp.hpp>
 
 #include <chrono>
 
+#include <cstddef>
+
 namespace yandex {
 namespace contest {
 namespace invoker {
@@ -16,9 +20,33 @@ struct ResourceLimits {
   void serialize(Archive &ar, const unsigned int) {
     using boost::serialization::make_nvp;
     ar & make_nvp("realTimeLimitMillis", realTimeLimit);
+    detail::serializeDefaulted(ar, "idleOnlyIfGroupIsIdle",
+                               idleOnlyIfGroupIsIdle);
+    detail::serializeDefaulted(ar, "exclusiveCores", exclusiveCores);
   }
 
   std::chrono::milliseconds realTimeLimit = std::chrono::seconds(10);
+
+  /*!
+   * \brief Process idle time limit is exceeded
+   * only if other running processes are idle too.
+   *
+   * Useful for interactive tasks: solution waiting for
+   * interactor is not idle until interactor is blocked as well.
+   *
+   * \see process::ResourceLimits::idleTimeLimit
+   */
+  bool idleOnlyIfGroupIsIdle = false;
+
+  /*!
+   * \brief Number of physical cores process group is pinned to.
+   *
+   * Cores are not shared with other process groups
+   * while process group is running, 0 disables pinning.
+   *
+   * \see CpuSetAllocator
+   */
+  std::size_t exclusiveCores = 0;
 };
 
 }  // namespace process_group
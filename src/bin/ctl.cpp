@@ -7,6 +7,9 @@
  * Use yandex::contest::invoker::detail::execution::AsyncProcessGroup
  * or cli instead.
  *
+ * With --persistent argument tasks are read from stdin
+ * until it is closed, stdin and stdout should be connected to a socket.
+ *
  * \see yandex::contest::invoker::detail::execution::AsyncProcessGroup
  * \see yandex::contest::invoker::ControlProcessSettings
  */
@@ -17,13 +20,20 @@
 #include <yandex/contest/system/Trace.hpp>
 
 #include <iostream>
+#include <string>
+
+#include <unistd.h>
 
-int main() {
+int main(int argc, char *argv[]) {
   try {
     yandex::contest::system::Trace::handle(SIGABRT);
     yandex::contest::system::Trace::handle(SIGSEGV);
     using yandex::contest::invoker::detail::execution::AsyncProcessGroup;
     using namespace yandex::contest::serialization;
+    if (argc == 2 && argv[1] == std::string("--persistent")) {
+      AsyncProcessGroup::serve(STDIN_FILENO, STDOUT_FILENO);
+      return 0;
+    }
     AsyncProcessGroup::Task task;
     BinaryReader::readFromStream(std::cin, task);
     BinaryWriter::writeToStream(std::cout, AsyncProcessGroup::execute(task));
@@ -1,5 +1,6 @@
 #include <yandex/contest/invoker/Container.hpp>
 
+#include <yandex/contest/invoker/ContainerError.hpp>
 #include <yandex/contest/invoker/ProcessGroup.hpp>
 
 #include <yandex/contest/system/execution/AsyncProcess.hpp>
@@ -11,12 +12,24 @@
 
 #include <boost/filesystem/operations.hpp>
 
+#include <algorithm>
+#include <vector>
+
 namespace yandex {
 namespace contest {
 namespace invoker {
 
 YANDEX_CONTEST_INTRUSIVE_PTR_DEFINE(Container)
 
+namespace {
+/// Container's cpuset, exclusive cores are allocated inside it.
+std::string lxcCpus(const lxc::Config &config) {
+  if (!config.cgroup) return std::string();
+  const auto iter = config.cgroup->find("cpuset.cpus");
+  return iter == config.cgroup->end() ? std::string() : iter->second;
+}
+}  // namespace
+
 ContainerPointer Container::create(const ContainerConfig &config) {
   STREAM_INFO << "Trying to create new container";
   boost::filesystem::path path;
@@ -44,8 +57,9 @@ ContainerPointer Container::create(const ContainerConfig &config) {
   try {
     STREAM_INFO << "New container directory was created: " << path << ".";
     STREAM_INFO << "Trying to create LXC at " << path << " .";
-    lxcPtr.reset(
-        new lxc::Lxc(path.filename().string(), path, config.lxcConfig));
+    lxcPtr.reset(new lxc::Lxc(path.filename().string(), path,
+                              config.lxcConfig, config.lxcBackend,
+                              config.lxcStopTimeout));
   } catch (...) {
     STREAM_ERROR << "Unable to create LXC at " << path << " .";
     boost::system::error_code ec;
@@ -77,7 +91,13 @@ Container::Container(std::unique_ptr<lxc::Lxc> &&lxcPtr,
                      const ContainerConfig &config)
     : filesystem_(lxcPtr->rootfs(), config.filesystemConfig),
       controlProcessOptions_(config.controlProcessConfig),
+      // only lxc-execute can start control process as AsyncProcess
+      persistentControlProcess_(config.controlProcessConfig.persistent ||
+                                config.lxcBackend != lxc::Backend::UTILITY),
+      initialProcessGroupDefaultSettings_(config.processGroupDefaultSettings),
       processGroupDefaultSettings_(config.processGroupDefaultSettings),
+      cpuSetAllocator_(CpuSetAllocator::instance(config.cpuSetLocksDir)),
+      cpus_(lxcCpus(config.lxcConfig)),
       lxcPtr_(std::move(lxcPtr)) {}
 
 Filesystem &Container::filesystem() { return filesystem_; }
@@ -86,6 +106,79 @@ ProcessGroupPointer Container::createProcessGroup() {
   return ProcessGroup::create(ContainerPointer(this));
 }
 
+void Container::executeBatch(
+    const std::vector<ProcessGroupPointer> &processGroups,
+    const std::size_t concurrency, const BatchCallback &callback) {
+  // process groups release container when completed
+  const ContainerPointer self(this);
+  detail::execution::AsyncProcessGroup::BatchTask batch;
+  batch.concurrency = concurrency;
+  std::size_t pinned = 0, exclusiveCores = 0;
+  for (const ProcessGroupPointer &processGroup : processGroups) {
+    BOOST_ASSERT(processGroup->container_ == self);
+    if (processGroup->processGroup_)
+      BOOST_THROW_EXCEPTION(ProcessGroupHasAlreadyStartedError());
+    batch.tasks.push_back(processGroup->task_);
+    if (const std::size_t cores =
+            processGroup->task_.resourceLimits.exclusiveCores) {
+      ++pinned;
+      exclusiveCores = std::max(exclusiveCores, cores);
+    }
+  }
+  if (batch.tasks.empty()) return;
+  // at most concurrency tasks run at once, they share these cores
+  const std::size_t sets =
+      std::min(pinned, std::max<std::size_t>(concurrency, 1));
+  std::vector<CpuSetAllocator::AllocationPointer> cores;
+  for (std::size_t i = 0; i < sets; ++i) {
+    cores.push_back(cpuSetAllocator_.allocate(exclusiveCores, cpus_));
+    batch.exclusiveCores.emplace_back();
+    for (std::size_t size = 1; size <= exclusiveCores; ++size)
+      batch.exclusiveCores.back().push_back(cores.back()->cpus(size));
+  }
+  if (!controlProcessDaemon_ || !controlProcessDaemon_->running()) {
+    startControlProcessDaemon();
+  } else if (controlProcessDaemon_->busy()) {
+    BOOST_THROW_EXCEPTION(
+        ContainerIllegalStateError()
+        << Error::message("Persistent control process is busy."));
+  }
+  STREAM_INFO << "Executing batch of " << batch.tasks.size()
+              << " process groups.";
+  std::string error;
+  try {
+    controlProcessDaemon_->start(batch);
+    while (controlProcessDaemon_->pending()) {
+      const detail::execution::AsyncProcessGroup::BatchResult result =
+          controlProcessDaemon_->waitBatch();
+      BOOST_ASSERT(result.id < processGroups.size());
+      if (!result.result) {
+        STREAM_ERROR << "Process group " << result.id << " "
+                     << "was not executed due to \"" << result.error << "\".";
+        if (error.empty()) error = result.error;
+        continue;
+      }
+      ProcessGroup &processGroup = *processGroups[result.id];
+      processGroup.processGroup_ =
+          detail::execution::AsyncProcessGroup(result.result.get());
+      processGroup.result_ = result.result;
+      processGroup.container_.reset();
+      if (callback) callback(processGroups[result.id]);
+    }
+  } catch (...) {
+    if (!persistentControlProcess_) controlProcessDaemon_.reset();
+    throw;
+  }
+  if (!persistentControlProcess_) controlProcessDaemon_.reset();
+  if (!error.empty()) {
+    system::execution::Result result;
+    result.exitStatus = 1;
+    result.err = error;
+    BOOST_THROW_EXCEPTION(
+        detail::execution::AsyncProcessGroupControlProcessError(result));
+  }
+}
+
 const ProcessGroup::DefaultSettings &Container::processGroupDefaultSettings()
     const {
   return processGroupDefaultSettings_;
@@ -98,6 +191,16 @@ void Container::setProcessGroupDefaultSettings(
 
 detail::execution::AsyncProcessGroup Container::execute(
     const detail::execution::AsyncProcessGroup::Task &task) {
+  if (persistentControlProcess_) {
+    if (!controlProcessDaemon_ || !controlProcessDaemon_->running()) {
+      startControlProcessDaemon();
+    } else if (controlProcessDaemon_->busy()) {
+      BOOST_THROW_EXCEPTION(
+          ContainerIllegalStateError()
+          << Error::message("Persistent control process is busy."));
+    }
+    return detail::execution::AsyncProcessGroup(controlProcessDaemon_, task);
+  }
   return lxcPtr_->execute(
       [&task](const system::execution::AsyncProcess::Options &options) {
         return detail::execution::AsyncProcessGroup(options, task);
@@ -107,6 +210,52 @@ detail::execution::AsyncProcessGroup Container::execute(
 
 void Container::stop() { lxcPtr_->stop(); }
 
+void Container::startControlProcessDaemon() {
+  // terminated control process should be reaped before LXC is reused
+  controlProcessDaemon_.reset();
+  detail::execution::AsyncProcess::Options options = controlProcessOptions_;
+  options.arguments = {options.executable.string(), "--persistent"};
+  // task processes outlive killed control process, container does not;
+  // process group holding the daemon holds this container too
+  lxc::Lxc *const lxcContainer = lxcPtr_.get();
+  const detail::execution::ControlProcessDaemon::Terminator terminator =
+      [lxcContainer] { lxcContainer->stop(); };
+  if (lxcPtr_->backend() != lxc::Backend::UTILITY) {
+    controlProcessDaemon_ =
+        std::make_shared<detail::execution::ControlProcessDaemon>(
+            [lxcContainer, &options](const std::function<void()> &setUp) {
+              return lxcContainer->start(options.arguments, setUp);
+            },
+            terminator);
+    return;
+  }
+  controlProcessDaemon_ = lxcPtr_->execute(
+      [&terminator](const system::execution::AsyncProcess::Options &options) {
+        return std::make_shared<detail::execution::ControlProcessDaemon>(
+            options, terminator);
+      },
+      options);
+}
+
+void Container::reset() {
+  STREAM_INFO << "Trying to reset container.";
+  // idle persistent control process keeps LXC running
+  const bool running =
+      controlProcessDaemon_ && controlProcessDaemon_->running()
+          ? controlProcessDaemon_->busy()
+          : lxcPtr_->state() != lxc::Lxc::State::STOPPED;
+  if (running) {
+    STREAM_ERROR << "Unable to reset running container, "
+                 << "exception is thrown.";
+    BOOST_THROW_EXCEPTION(
+        ContainerIllegalStateError()
+        << Error::message("Unable to reset container while it is running."));
+  }
+  filesystem_.reset();
+  processGroupDefaultSettings_ = initialProcessGroupDefaultSettings_;
+  STREAM_INFO << "Container was successfully reset.";
+}
+
 }  // namespace invoker
 }  // namespace contest
 }  // namespace yandex
@@ -0,0 +1,113 @@
+#include <yandex/contest/invoker/ContainerPool.hpp>
+
+#include <yandex/contest/StreamLog.hpp>
+
+#include <boost/assert.hpp>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+
+ContainerPool::ContainerPool(const ContainerConfig &config,
+                             const std::size_t size)
+    : config_(config), size_(size) {
+  // pooled containers are reset on release
+  config_.filesystemConfig.snapshot = true;
+  worker_ = boost::thread(&ContainerPool::run, this);
+}
+
+ContainerPool::~ContainerPool() {
+  {
+    const boost::lock_guard<boost::mutex> lk(lock_);
+    stopped_ = true;
+  }
+  changed_.notify_all();
+  worker_.join();
+  released_.clear();
+  ready_.clear();
+}
+
+ContainerPointer ContainerPool::acquire() {
+  ContainerPointer container;
+  {
+    const boost::lock_guard<boost::mutex> lk(lock_);
+    if (!ready_.empty()) {
+      container = ready_.front();
+      ready_.pop_front();
+    }
+    // give worker another chance after failure
+    failed_ = false;
+  }
+  changed_.notify_all();
+  if (!container) {
+    STREAM_INFO << "Container pool is exhausted, "
+                << "creating container synchronously.";
+    container = Container::create(config_);
+  }
+  return container;
+}
+
+void ContainerPool::release(const ContainerPointer &container) {
+  BOOST_ASSERT(container);
+  {
+    const boost::lock_guard<boost::mutex> lk(lock_);
+    released_.push_back(container);
+  }
+  changed_.notify_all();
+}
+
+std::size_t ContainerPool::ready() const {
+  const boost::lock_guard<boost::mutex> lk(lock_);
+  return ready_.size();
+}
+
+bool ContainerPool::hasWork() const {
+  return !released_.empty() || (!failed_ && ready_.size() < size_);
+}
+
+void ContainerPool::run() {
+  boost::unique_lock<boost::mutex> lk(lock_);
+  for (;;) {
+    changed_.wait(lk, [this] { return stopped_ || hasWork(); });
+    if (stopped_) return;
+    if (!released_.empty()) {
+      ContainerPointer container = released_.front();
+      released_.pop_front();
+      lk.unlock();
+      try {
+        container->reset();
+      } catch (std::exception &e) {
+        STREAM_ERROR << "Unable to reset pooled container due to \""
+                     << e.what() << "\", it will be replaced.";
+        container.reset();
+      }
+      lk.lock();
+      if (container && ready_.size() < size_) {
+        ready_.push_back(container);
+      } else if (container) {
+        // pool is full, destroy container without lock
+        lk.unlock();
+        container.reset();
+        lk.lock();
+      }
+    } else {
+      lk.unlock();
+      ContainerPointer container;
+      try {
+        container = Container::create(config_);
+      } catch (std::exception &e) {
+        STREAM_ERROR << "Unable to create pooled container due to \""
+                     << e.what() << "\", waiting for the next request.";
+      }
+      lk.lock();
+      if (container)
+        ready_.push_back(container);
+      else
+        failed_ = true;
+    }
+  }
+}
+
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
@@ -0,0 +1,164 @@
+#include <yandex/contest/invoker/CpuSetAllocator.hpp>
+
+#include <yandex/contest/invoker/detail/CpuList.hpp>
+
+#include <yandex/contest/system/unistd/Operations.hpp>
+
+#include <yandex/contest/StreamLog.hpp>
+#include <yandex/contest/SystemError.hpp>
+
+#include <bunsan/filesystem/fstream.hpp>
+
+#include <boost/assert.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/optional.hpp>
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <utility>
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/file.h>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+
+namespace {
+/// Integer from /sys/devices/system/cpu/cpuN/topology.
+boost::optional<int> readTopology(const int cpu, const std::string &name) {
+  const boost::filesystem::path path =
+      boost::filesystem::path("/sys/devices/system/cpu") /
+      ("cpu" + std::to_string(cpu)) / "topology" / name;
+  if (!boost::filesystem::exists(path)) return boost::none;
+  int value;
+  bunsan::filesystem::ifstream fin(path);
+  BUNSAN_FILESYSTEM_FSTREAM_WRAP_BEGIN(fin) {
+    fin >> value;
+  } BUNSAN_FILESYSTEM_FSTREAM_WRAP_END(fin)
+  fin.close();
+  return value;
+}
+
+std::string readOnlineCpus() {
+  std::string cpus;
+  bunsan::filesystem::ifstream fin("/sys/devices/system/cpu/online");
+  BUNSAN_FILESYSTEM_FSTREAM_WRAP_BEGIN(fin) {
+    std::getline(fin, cpus);
+  } BUNSAN_FILESYSTEM_FSTREAM_WRAP_END(fin)
+  fin.close();
+  return cpus;
+}
+
+/// CPUs current process is allowed to run on.
+std::set<int> affinityCpus() {
+  ::cpu_set_t affinity;
+  CPU_ZERO(&affinity);
+  if (::sched_getaffinity(0, sizeof(affinity), &affinity) < 0)
+    BOOST_THROW_EXCEPTION(SystemError("sched_getaffinity"));
+  std::set<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    if (CPU_ISSET(cpu, &affinity)) cpus.insert(cpu);
+  return cpus;
+}
+}  // namespace
+
+const std::vector<CpuSetAllocator::Core> &CpuSetAllocator::topology() {
+  // topology does not change while process is running
+  static const std::vector<Core> cores = [] {
+    // ordered by package and core id, it is the lock file name
+    std::map<std::pair<int, int>, Core> byId;
+    for (const int cpu : detail::parseCpuList(readOnlineCpus())) {
+      const boost::optional<int> package =
+          readTopology(cpu, "physical_package_id");
+      const boost::optional<int> core = readTopology(cpu, "core_id");
+      // without topology each CPU is a core of its own
+      const std::pair<int, int> id =
+          package && core ? std::make_pair(*package, *core)
+                          : std::make_pair(-1, cpu);
+      Core &entry = byId[id];
+      if (entry.name.empty())
+        entry.name = package && core ? "package" + std::to_string(*package) +
+                                           "_core" + std::to_string(*core)
+                                     : "cpu" + std::to_string(cpu);
+      entry.cpus.push_back(cpu);
+    }
+    std::vector<Core> cores;
+    for (auto &core : byId) cores.push_back(std::move(core.second));
+    STREAM_DEBUG << "CPU set allocator found " << cores.size() << " "
+                 << "physical cores.";
+    return cores;
+  }();
+  return cores;
+}
+
+std::string CpuSetAllocator::Allocation::cpus(const std::size_t cores) const {
+  BOOST_ASSERT(cores <= coreCpus_.size());
+  std::vector<int> cpus;
+  for (std::size_t i = 0; i < cores; ++i)
+    cpus.insert(cpus.end(), coreCpus_[i].begin(), coreCpus_[i].end());
+  return detail::formatCpuList(cpus);
+}
+
+const CpuSetAllocator &CpuSetAllocator::instance(
+    const boost::filesystem::path &locksDir) {
+  static std::mutex lock;
+  static std::map<boost::filesystem::path, std::unique_ptr<CpuSetAllocator>>
+      allocators;
+  const std::lock_guard<std::mutex> guard(lock);
+  std::unique_ptr<CpuSetAllocator> &allocator = allocators[locksDir];
+  if (!allocator) allocator.reset(new CpuSetAllocator(locksDir));
+  return *allocator;
+}
+
+CpuSetAllocator::CpuSetAllocator(const boost::filesystem::path &locksDir)
+    : locksDir_(locksDir), cores_(topology()) {}
+
+CpuSetAllocator::AllocationPointer CpuSetAllocator::allocate(
+    const std::size_t cores, const std::string &allowed) const {
+  std::set<int> allowedCpus;
+  if (allowed.empty()) {
+    allowedCpus = affinityCpus();
+  } else {
+    for (const int cpu : detail::parseCpuList(allowed)) allowedCpus.insert(cpu);
+  }
+  boost::filesystem::create_directories(locksDir_);
+  AllocationPointer allocation(new Allocation);
+  std::vector<int> cpus;
+  for (const Core &core : cores_) {
+    if (allocation->locks_.size() == cores) break;
+    // core may be split by cpuset, its other siblings are not ours,
+    // but the whole core is locked so nobody else gets them
+    std::vector<int> coreCpus;
+    for (const int cpu : core.cpus)
+      if (allowedCpus.count(cpu)) coreCpus.push_back(cpu);
+    if (coreCpus.empty()) continue;
+    system::unistd::Descriptor lock =
+        system::unistd::open(locksDir_ / core.name,
+                             O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (::flock(lock.get(), LOCK_EX | LOCK_NB) < 0) {
+      if (errno == EWOULDBLOCK) continue;
+      BOOST_THROW_EXCEPTION(SystemError("flock"));
+    }
+    allocation->locks_.push_back(std::move(lock));
+    cpus.insert(cpus.end(), coreCpus.begin(), coreCpus.end());
+    allocation->coreCpus_.push_back(std::move(coreCpus));
+  }
+  if (allocation->locks_.size() < cores) {
+    BOOST_THROW_EXCEPTION(
+        CpuSetAllocatorExhaustedError()
+        << CpuSetAllocatorError::cores(cores)
+        << Error::message("Not enough free physical cores."));
+  }
+  allocation->cpus_ = detail::formatCpuList(cpus);
+  STREAM_DEBUG << "CPUs " << allocation->cpus_ << " were allocated.";
+  return allocation;
+}
+
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
@@ -21,10 +21,23 @@ Filesystem::Filesystem(const boost::filesystem::path &containerRoot,
   for (filesystem::CreateFile createFile : config.createFiles)
     createFile.create(containerRoot_);
   STREAM_INFO << "Requested files were successfully created.";
+  if (config.snapshot)
+    snapshot_.reset(new filesystem::Snapshot(
+        containerRoot_,
+        containerRoot_.parent_path() /
+            (containerRoot_.filename().string() + ".snapshot")));
 }
 
 Filesystem::~Filesystem() {}
 
+void Filesystem::reset() {
+  if (!snapshot_)
+    BOOST_THROW_EXCEPTION(
+        FilesystemSnapshotIsNotTakenError()
+        << Error::message("Snapshot was not requested by configuration."));
+  snapshot_->restore();
+}
+
 const boost::filesystem::path &Filesystem::containerRoot() const {
   return containerRoot_;
 }
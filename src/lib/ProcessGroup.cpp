@@ -52,20 +52,33 @@ Pipe ProcessGroup::createPipe() {
 void ProcessGroup::start() {
   if (processGroup_)
     BOOST_THROW_EXCEPTION(ProcessGroupHasAlreadyStartedError());
-  processGroup_ = container_->execute(task_);
+  allocateCores();
+  try {
+    processGroup_ = container_->execute(task_);
+  } catch (...) {
+    cores_.reset();
+    throw;
+  }
 }
 
 void ProcessGroup::stop() {
   if (!processGroup_) BOOST_THROW_EXCEPTION(ProcessGroupHasNotStartedError());
   if (!container_)
     BOOST_THROW_EXCEPTION(ProcessGroupHasAlreadyTerminatedError());
-  container_->stop();
+  // completed control process does not need container to be stopped
+  bool completed = true;
+  try {
+    completed = static_cast<bool>(processGroup_.poll());
+  } catch (detail::execution::AsyncProcessGroupControlProcessError &e) {
+  }
+  if (!completed) container_->stop();
   try {
     wait();
   } catch (detail::execution::AsyncProcessGroupControlProcessError &e) {
     // it's OK, stop() caused it
   }
   container_.reset();
+  cores_.reset();
   result_ = detail::execution::AsyncProcessGroup::Result();
   result_->processGroupResult.completionStatus =
       ProcessGroup::Result::CompletionStatus::STOPPED;
@@ -84,6 +97,7 @@ boost::optional<ProcessGroup::Result> ProcessGroup::poll() {
   if (!result_) result_ = processGroup_.poll();
   if (result_) {
     container_.reset();
+    cores_.reset();
     return result_->processGroupResult;
   } else {
     return boost::optional<ProcessGroup::Result>();
@@ -95,6 +109,7 @@ const ProcessGroup::Result &ProcessGroup::wait() {
   if (!result_) {
     result_ = processGroup_.wait();
     container_.reset();
+    cores_.reset();
   }
   BOOST_ASSERT(result_);
   return result_->processGroupResult;
@@ -120,6 +135,12 @@ void ProcessGroup::setResourceLimits(
   task_.resourceLimits = resourceLimits;
 }
 
+bool ProcessGroup::parallelStart() const { return task_.parallelStart; }
+
+void ProcessGroup::setParallelStart(const bool parallelStart) {
+  task_.parallelStart = parallelStart;
+}
+
 void ProcessGroup::setNotifier(const std::size_t notifierId,
                                const NotificationStream &notificationStream) {
   if (notificationStream.pipeEnd.end != Pipe::End::WRITE)
@@ -206,6 +227,13 @@ const process::Result &ProcessGroup::processResult(const std::size_t id) {
   return result_->processResults[id];
 }
 
+void ProcessGroup::allocateCores() {
+  if (!task_.resourceLimits.exclusiveCores) return;
+  cores_ = container_->cpuSetAllocator_.allocate(
+      task_.resourceLimits.exclusiveCores, container_->cpus_);
+  task_.cpus = cores_->cpus();
+}
+
 }  // namespace invoker
 }  // namespace contest
 }  // namespace yandex
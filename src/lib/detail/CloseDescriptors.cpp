@@ -0,0 +1,37 @@
+#include <yandex/contest/invoker/detail/CloseDescriptors.hpp>
+
+#include <cerrno>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef SYS_close_range
+#define SYS_close_range 436
+#endif
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+
+namespace {
+bool closeRange(const unsigned first, const unsigned last,
+                const unsigned maxFd) noexcept {
+  if (first > last) return true;
+  if (::syscall(SYS_close_range, first, last, 0) == 0) return true;
+  if (errno != ENOSYS) return false;
+  // old kernel
+  for (unsigned fd = first; fd <= last && fd < maxFd; ++fd) ::close(fd);
+  return true;
+}
+}  // namespace
+
+bool closeDescriptors(const int keep, const unsigned maxFd) noexcept {
+  if (keep < 3) return closeRange(3, ~0U, maxFd);
+  return closeRange(3, keep - 1, maxFd) && closeRange(keep + 1, ~0U, maxFd);
+}
+
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
@@ -0,0 +1,40 @@
+#include <yandex/contest/invoker/detail/CpuList.hpp>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/join.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/lexical_cast.hpp>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+
+std::vector<int> parseCpuList(const std::string &cpus) {
+  std::vector<std::string> ranges;
+  boost::algorithm::split(ranges, boost::algorithm::trim_copy(cpus),
+                          boost::algorithm::is_any_of(","));
+  std::vector<int> list;
+  for (const std::string &range : ranges) {
+    if (range.empty()) continue;
+    const std::size_t dash = range.find('-');
+    const int first = boost::lexical_cast<int>(range.substr(0, dash));
+    const int last = dash == std::string::npos
+                         ? first
+                         : boost::lexical_cast<int>(range.substr(dash + 1));
+    for (int cpu = first; cpu <= last; ++cpu) list.push_back(cpu);
+  }
+  return list;
+}
+
+std::string formatCpuList(const std::vector<int> &cpus) {
+  std::vector<std::string> cpuStrings;
+  for (const int cpu : cpus) cpuStrings.push_back(std::to_string(cpu));
+  return boost::algorithm::join(cpuStrings, ",");
+}
+
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
@@ -1,5 +1,7 @@
 #include <yandex/contest/invoker/detail/execution/AsyncProcessGroup.hpp>
 
+#include <yandex/contest/invoker/detail/execution/ControlProcessDaemon.hpp>
+
 #include <yandex/contest/SerializationCast.hpp>
 #include <yandex/contest/StreamLog.hpp>
 
@@ -24,6 +26,15 @@ AsyncProcessGroup::AsyncProcessGroup(const AsyncProcess::Options &options,
                                      const Task &task)
     : controlProcess_(apply(options, task)) {}
 
+AsyncProcessGroup::AsyncProcessGroup(
+    const std::shared_ptr<ControlProcessDaemon> &daemon, const Task &task)
+    : daemon_(daemon) {
+  BOOST_ASSERT(daemon_);
+  daemon_->start(task);
+}
+
+AsyncProcessGroup::AsyncProcessGroup(const Result &result) : result_(result) {}
+
 AsyncProcessGroup::AsyncProcessGroup(AsyncProcessGroup &&processGroup) {
   swap(processGroup);
 }
@@ -36,12 +47,14 @@ AsyncProcessGroup &AsyncProcessGroup::operator=(
 }
 
 AsyncProcessGroup::operator bool() const noexcept {
-  return static_cast<bool>(controlProcess_);
+  return static_cast<bool>(controlProcess_) || static_cast<bool>(daemon_) ||
+         static_cast<bool>(result_);
 }
 
 void AsyncProcessGroup::swap(AsyncProcessGroup &processGroup) noexcept {
   using boost::swap;
   swap(controlProcess_, processGroup.controlProcess_);
+  swap(daemon_, processGroup.daemon_);
   swap(result_, processGroup.result_);
 }
 
@@ -54,17 +67,33 @@ const AsyncProcessGroup::Result &AsyncProcessGroup::wait() {
 
 const boost::optional<AsyncProcessGroup::Result> &AsyncProcessGroup::poll() {
   BOOST_ASSERT_MSG(*this, "Invalid AsyncProcessGroup instance.");
-  if (!result_ && controlProcess_.poll()) readResult();
+  if (!result_) {
+    if (daemon_)
+      result_ = daemon_->poll();
+    else if (controlProcess_.poll())
+      readResult();
+  }
   return result_;
 }
 
 void AsyncProcessGroup::stop() {
   BOOST_ASSERT_MSG(*this, "Invalid AsyncProcessGroup instance.");
-  controlProcess_.stop();
+  if (result_) return;
+  if (daemon_) {
+    // control process has already failed
+    if (!daemon_->busy()) return;
+    daemon_->stop();
+  } else {
+    controlProcess_.stop();
+  }
   readResult();
 }
 
 void AsyncProcessGroup::readResult() {
+  if (daemon_) {
+    result_ = daemon_->wait();
+    return;
+  }
   const execution::Result result = controlProcess_.wait();
   if (result) {
     try {
@@ -0,0 +1,214 @@
+#include "BatchExecutor.hpp"
+
+#include "ControlGroupPool.hpp"
+#include "ProcessGroupStarter.hpp"
+
+#include <yandex/contest/system/unistd/Operations.hpp>
+
+#include <yandex/contest/SerializationCast.hpp>
+#include <yandex/contest/StreamLog.hpp>
+#include <yandex/contest/SystemError.hpp>
+
+#include <boost/assert.hpp>
+#include <boost/format.hpp>
+
+#include <array>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+namespace async_process_group_detail {
+
+namespace {
+void writeAll(const int fd, const std::string &data) {
+  std::size_t written = 0;
+  while (written < data.size()) {
+    const ssize_t size =
+        ::write(fd, data.data() + written, data.size() - written);
+    if (size < 0) {
+      if (errno == EINTR) continue;
+      BOOST_THROW_EXCEPTION(SystemError("write"));
+    }
+    written += size;
+  }
+}
+}  // namespace
+
+BatchExecutor::BatchExecutor(const AsyncProcessGroup::BatchTask &batch,
+                             const AsyncProcessGroup::BatchCallback &callback)
+    : batch_(batch), callback_(callback) {
+  for (std::size_t i = 0; i < batch_.exclusiveCores.size(); ++i)
+    freeCores_.push_back(i);
+}
+
+void BatchExecutor::executionLoop() {
+  const std::size_t size = batch_.tasks.size();
+  if (batch_.concurrency <= 1 || size <= 1) {
+    STREAM_DEBUG << "Executing " << size << " tasks sequentially...";
+    for (std::size_t id = 0; id < size; ++id) {
+      const boost::optional<std::size_t> cores = acquireCores(id);
+      const AsyncProcessGroup::BatchResult result = run(id, cores);
+      releaseCores(cores);
+      callback_(result);
+    }
+    return;
+  }
+  STREAM_DEBUG << "Executing " << size << " tasks "
+               << "using up to " << batch_.concurrency << " workers...";
+  thisCgroup_ = ProcessControlGroup::forSelf();
+  std::size_t next = 0;
+  while (next < size || !workers_.empty()) {
+    while (next < size && workers_.size() < batch_.concurrency) spawn(next++);
+    collect();
+  }
+  thisCgroup_.reset();
+}
+
+boost::optional<std::size_t> BatchExecutor::acquireCores(
+    const std::size_t id) {
+  BOOST_ASSERT(id < batch_.tasks.size());
+  if (!batch_.tasks[id].resourceLimits.exclusiveCores || freeCores_.empty())
+    return boost::none;
+  const std::size_t cores = freeCores_.back();
+  freeCores_.pop_back();
+  return cores;
+}
+
+void BatchExecutor::releaseCores(const boost::optional<std::size_t> &cores) {
+  if (cores) freeCores_.push_back(*cores);
+}
+
+AsyncProcessGroup::BatchResult BatchExecutor::run(
+    const std::size_t id, const boost::optional<std::size_t> &cores) const {
+  BOOST_ASSERT(id < batch_.tasks.size());
+  AsyncProcessGroup::BatchResult result;
+  result.id = id;
+  try {
+    AsyncProcessGroup::Task task = batch_.tasks[id];
+    if (const std::size_t exclusiveCores =
+            task.resourceLimits.exclusiveCores) {
+      if (!cores || exclusiveCores > batch_.exclusiveCores[*cores].size())
+        BOOST_THROW_EXCEPTION(Error() << Error::message(
+                                  "Not enough free exclusive cores."));
+      task.cpus = batch_.exclusiveCores[*cores][exclusiveCores - 1];
+    }
+    result.result = AsyncProcessGroup::execute(task);
+  } catch (std::exception &e) {
+    STREAM_ERROR << "Unable to execute task " << id << " due to \""
+                 << e.what() << "\".";
+    result.error = e.what();
+  }
+  return result;
+}
+
+void BatchExecutor::spawn(const std::size_t id) {
+  int fds[2];
+  if (::pipe2(fds, O_CLOEXEC) < 0) BOOST_THROW_EXCEPTION(SystemError("pipe2"));
+  system::unistd::Descriptor readEnd(fds[0]), writeEnd(fds[1]);
+  Worker worker;
+  worker.id = id;
+  worker.cores = acquireCores(id);
+  // worker's control groups should not clash with other workers
+  worker.controlGroup =
+      thisCgroup_->createChild(str(boost::format("batch_%1%") % id));
+  // cgroup v1 cpuset of new control group is empty
+  worker.controlGroup->configure();
+  worker.pid = system::unistd::fork();
+  if (worker.pid == 0) startWorker(worker, writeEnd.get());
+  STREAM_TRACE << "Worker for task " << id << " was started "
+               << "pid = " << worker.pid << ".";
+  worker.output = std::move(readEnd);
+  workers_.push_back(std::move(worker));
+}
+
+void BatchExecutor::startWorker(const Worker &worker,
+                                const int output) noexcept {
+  const std::size_t id = worker.id;
+  try {
+    // worker should not hold control process streams
+    const system::unistd::Descriptor null =
+        system::unistd::open("/dev/null", O_RDWR);
+    system::unistd::dup2(null.get(), STDIN_FILENO);
+    system::unistd::dup2(null.get(), STDOUT_FILENO);
+    worker.controlGroup->attachSelf();
+    // pooled control groups belong to parent's control group
+    ControlGroupPool::instance().disableInChild();
+    writeAll(output, serialization::serialize(run(id, worker.cores)));
+    ::_exit(0);
+  } catch (std::exception &e) {
+    STREAM_ERROR << "Worker for task " << id << " has failed due to \""
+                 << e.what() << "\".";
+  } catch (...) {
+  }
+  ::_exit(1);
+}
+
+void BatchExecutor::collect() {
+  std::vector<::pollfd> fds;
+  for (const Worker &worker : workers_)
+    fds.push_back(::pollfd{worker.output.get(), POLLIN, 0});
+  while (::poll(fds.data(), fds.size(), -1) < 0) {
+    if (errno != EINTR) BOOST_THROW_EXCEPTION(SystemError("poll"));
+  }
+  std::array<char, 64 * 1024> buffer;
+  auto iter = workers_.begin();
+  for (const ::pollfd &fd : fds) {
+    const auto worker = iter++;
+    if (!fd.revents) continue;
+    const ssize_t size = ::read(fd.fd, buffer.data(), buffer.size());
+    if (size < 0) {
+      if (errno == EINTR) continue;
+      BOOST_THROW_EXCEPTION(SystemError("read"));
+    }
+    if (size > 0) {
+      worker->data.append(buffer.data(), size);
+    } else {
+      complete(*worker);
+      workers_.erase(worker);
+    }
+  }
+}
+
+void BatchExecutor::complete(Worker &worker) {
+  int statLoc;
+  while (::waitpid(worker.pid, &statLoc, 0) < 0) {
+    if (errno != EINTR) BOOST_THROW_EXCEPTION(SystemError("waitpid"));
+  }
+  STREAM_TRACE << "Worker for task " << worker.id << " has terminated.";
+  // worker may have crashed leaving processes behind
+  worker.controlGroup->terminate();
+  worker.controlGroup.reset();
+  releaseCores(worker.cores);
+  AsyncProcessGroup::BatchResult result;
+  bool completed = WIFEXITED(statLoc) && WEXITSTATUS(statLoc) == 0;
+  if (completed) {
+    try {
+      result = serialization::deserialize<AsyncProcessGroup::BatchResult>(
+          worker.data);
+    } catch (std::exception &) {
+      completed = false;
+    }
+  }
+  if (!completed) {
+    result = AsyncProcessGroup::BatchResult();
+    result.id = worker.id;
+    result.error = "Worker has terminated unexpectedly.";
+  }
+  BOOST_ASSERT(result.id == worker.id);
+  callback_(result);
+}
+
+}  // namespace async_process_group_detail
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
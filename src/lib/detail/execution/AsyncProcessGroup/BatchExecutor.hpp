@@ -0,0 +1,85 @@
+#pragma once
+
+#include "ProcessInfo.hpp"
+
+#include <yandex/contest/invoker/detail/execution/AsyncProcessGroup.hpp>
+
+#include <yandex/contest/system/unistd/Descriptor.hpp>
+
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+
+#include <list>
+#include <string>
+#include <vector>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+namespace async_process_group_detail {
+
+/*!
+ * \brief Executes tasks of BatchTask.
+ *
+ * If concurrency is greater than 1 every task is executed
+ * by forked worker in its own control group,
+ * worker sends serialized BatchResult through a pipe.
+ *
+ * Tasks requesting exclusive cores are pinned to a free set
+ * of BatchTask::exclusiveCores when started.
+ */
+class BatchExecutor : private boost::noncopyable {
+ public:
+  BatchExecutor(const AsyncProcessGroup::BatchTask &batch,
+                const AsyncProcessGroup::BatchCallback &callback);
+
+  void executionLoop();
+
+ private:
+  struct Worker {
+    std::size_t id;
+    Pid pid;
+    system::unistd::Descriptor output;
+    std::string data;
+    ProcessControlGroupPointer controlGroup;
+    boost::optional<std::size_t> cores;
+  };
+
+ private:
+  /// Free set of exclusive cores if task requests them.
+  boost::optional<std::size_t> acquireCores(std::size_t id);
+
+  void releaseCores(const boost::optional<std::size_t> &cores);
+
+  /// Execute task in current process using specified set of cores.
+  AsyncProcessGroup::BatchResult run(
+      std::size_t id, const boost::optional<std::size_t> &cores) const;
+
+  void spawn(std::size_t id);
+
+  /// Never returns.
+  void startWorker(const Worker &worker, int output) noexcept;
+
+  /// Wait for workers output, complete terminated workers.
+  void collect();
+
+  void complete(Worker &worker);
+
+ private:
+  const AsyncProcessGroup::BatchTask &batch_;
+  const AsyncProcessGroup::BatchCallback callback_;
+  ProcessControlGroupPointer thisCgroup_;
+  std::list<Worker> workers_;
+
+  /// Indices of BatchTask::exclusiveCores.
+  std::vector<std::size_t> freeCores_;
+};
+
+}  // namespace async_process_group_detail
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
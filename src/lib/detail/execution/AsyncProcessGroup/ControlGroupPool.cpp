@@ -0,0 +1,101 @@
+#include "ControlGroupPool.hpp"
+
+#include <yandex/contest/StreamLog.hpp>
+
+#include <boost/assert.hpp>
+#include <boost/format.hpp>
+
+#include <sstream>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+namespace async_process_group_detail {
+
+ControlGroupPool &ControlGroupPool::instance() {
+  static ControlGroupPool pool;
+  return pool;
+}
+
+ControlGroupPool::~ControlGroupPool() {
+  try {
+    idle_.clear();
+  } catch (...) {
+  }
+}
+
+ProcessControlGroupPointer ControlGroupPool::acquire(
+    const ProcessControlGroupPointer &parent) {
+  const std::string key_ = key(parent);
+  ProcessControlGroupPointer controlGroup;
+  std::size_t id;
+  {
+    const std::lock_guard<std::mutex> lk(lock_);
+    auto &idle = idle_[key_];
+    if (!idle.empty()) {
+      controlGroup = idle.back();
+      idle.pop_back();
+      acquired_[controlGroup.get()] = key_;
+      STREAM_TRACE << "Reusing " << *controlGroup << ".";
+      return controlGroup;
+    }
+    id = created_++;
+  }
+  // we don't children to have access to cgroups
+  controlGroup = parent->createChild(str(boost::format("pool_%1%") % id));
+  controlGroup->configure();
+  const std::lock_guard<std::mutex> lk(lock_);
+  acquired_[controlGroup.get()] = key_;
+  return controlGroup;
+}
+
+void ControlGroupPool::release(
+    const ProcessControlGroupPointer &controlGroup) {
+  BOOST_ASSERT(controlGroup);
+  std::string key_;
+  {
+    const std::lock_guard<std::mutex> lk(lock_);
+    const auto iter = acquired_.find(controlGroup.get());
+    BOOST_ASSERT(iter != acquired_.end());
+    key_ = iter->second;
+    acquired_.erase(iter);
+    if (!enabled_) return;
+  }
+  try {
+    if (!controlGroup->reset()) return;
+  } catch (std::exception &e) {
+    STREAM_DEBUG << "Unable to reset " << *controlGroup << " due to \""
+                 << e.what() << "\", it will be removed.";
+    return;
+  }
+  const std::lock_guard<std::mutex> lk(lock_);
+  idle_[key_].push_back(controlGroup);
+}
+
+void ControlGroupPool::disableInChild() {
+  const std::lock_guard<std::mutex> lk(lock_);
+  enabled_ = false;
+  // intentionally leaked, destructors would remove control groups
+  auto *const inherited =
+      new std::vector<ProcessControlGroupPointer>();
+  for (auto &idle : idle_)
+    for (ProcessControlGroupPointer &controlGroup : idle.second)
+      inherited->push_back(std::move(controlGroup));
+  idle_.clear();
+  acquired_.clear();
+}
+
+std::string ControlGroupPool::key(const ProcessControlGroupPointer &parent) {
+  std::ostringstream buf;
+  buf << *parent << '\n' << parent->cpus() << '\n' << parent->mems();
+  return buf.str();
+}
+
+}  // namespace async_process_group_detail
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ProcessControlGroup.hpp"
+
+#include <boost/noncopyable.hpp>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+namespace async_process_group_detail {
+
+/*!
+ * \brief Per-process control groups reused between runs.
+ *
+ * Control groups are configured once when created
+ * and are reset when released, so starting a process
+ * does not create or configure anything in cgroupfs.
+ * Idle control groups are keyed by parent control group
+ * and parent's cpuset, so they are never reused
+ * with a configuration they were not created for.
+ * Control groups that can't be reset (cgroup v2) are not reused.
+ *
+ * Thread-safe.
+ */
+class ControlGroupPool : private boost::noncopyable {
+ public:
+  static ControlGroupPool &instance();
+
+  /// Configured empty child of parent.
+  ProcessControlGroupPointer acquire(
+      const ProcessControlGroupPointer &parent);
+
+  /*!
+   * \brief Return control group acquired from this pool.
+   *
+   * Control group is removed if it is not empty
+   * or accounting can't be reset.
+   */
+  void release(const ProcessControlGroupPointer &controlGroup);
+
+  /*!
+   * \brief Stop pooling in forked process.
+   *
+   * Inherited idle control groups belong to parent process,
+   * they are forgotten without removal.
+   * Released control groups are removed.
+   */
+  void disableInChild();
+
+  /// Remove idle control groups.
+  ~ControlGroupPool();
+
+ private:
+  ControlGroupPool() = default;
+
+  static std::string key(const ProcessControlGroupPointer &parent);
+
+ private:
+  std::mutex lock_;
+  bool enabled_ = true;
+  std::size_t created_ = 0;
+  std::unordered_map<std::string, std::vector<ProcessControlGroupPointer>>
+      idle_;
+
+  /// Keys of acquired control groups.
+  std::unordered_map<const ProcessControlGroup *, std::string>
+      acquired_;
+};
+
+}  // namespace async_process_group_detail
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
@@ -0,0 +1,184 @@
+#include "EventLoop.hpp"
+
+#include <yandex/contest/StreamLog.hpp>
+#include <yandex/contest/SystemError.hpp>
+
+#include <boost/assert.hpp>
+
+#include <array>
+
+#include <cstdint>
+
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+namespace async_process_group_detail {
+
+namespace {
+::sigset_t blockChildSignal() {
+  ::sigset_t mask, oldMask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+  const int errno_ = ::pthread_sigmask(SIG_BLOCK, &mask, &oldMask);
+  if (errno_) BOOST_THROW_EXCEPTION(SystemError(errno_, "pthread_sigmask"));
+  return oldMask;
+}
+
+int epollCreate() {
+  const int fd = ::epoll_create1(EPOLL_CLOEXEC);
+  if (fd < 0) BOOST_THROW_EXCEPTION(SystemError("epoll_create1"));
+  return fd;
+}
+
+int childSignalFd() {
+  ::sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+  const int fd = ::signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (fd < 0) BOOST_THROW_EXCEPTION(SystemError("signalfd"));
+  return fd;
+}
+
+int timerFd() {
+  const int fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (fd < 0) BOOST_THROW_EXCEPTION(SystemError("timerfd_create"));
+  return fd;
+}
+
+/// Read everything from non-blocking descriptor.
+template <typename T>
+void drain(const int fd) {
+  T buffer;
+  ssize_t size;
+  do {
+    size = ::read(fd, &buffer, sizeof(buffer));
+  } while (size > 0 || (size < 0 && errno == EINTR));
+  if (size < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+    BOOST_THROW_EXCEPTION(SystemError("read"));
+}
+}  // namespace
+
+EventLoop::EventLoop(const ChildHandler &childHandler)
+    : originalSignalMask_(blockChildSignal()),
+      epollFd_(epollCreate()),
+      signalFd_(childSignalFd()),
+      timerFd_(timerFd()),
+      childHandler_(childHandler) {
+  addToEpoll(signalFd_.get());
+  addToEpoll(timerFd_.get());
+}
+
+EventLoop::~EventLoop() {
+  // pending SIGCHLD is ignored by default
+  ::pthread_sigmask(SIG_SETMASK, &originalSignalMask_, nullptr);
+}
+
+void EventLoop::addDescriptor(const int fd, const DescriptorHandler &handler,
+                              const std::uint32_t events) {
+  BOOST_ASSERT(descriptorHandlers_.find(fd) == descriptorHandlers_.end());
+  addToEpoll(fd, events);
+  descriptorHandlers_[fd] = handler;
+}
+
+void EventLoop::removeDescriptor(const int fd) {
+  if (descriptorHandlers_.erase(fd)) {
+    if (::epoll_ctl(epollFd_.get(), EPOLL_CTL_DEL, fd, nullptr) < 0)
+      BOOST_THROW_EXCEPTION(SystemError("epoll_ctl"));
+  }
+}
+
+void EventLoop::runUntil(const TimePoint &deadline) {
+  if (Clock::now() >= deadline) {
+    // dispatch pending events only
+    wait(0);
+  } else {
+    setDeadline(deadline);
+    wait(-1);
+  }
+}
+
+void EventLoop::run() {
+  setDeadline(TimePoint());
+  wait(-1);
+}
+
+void EventLoop::wait(const int timeout) {
+  STREAM_TRACE << "Waiting for events [timeout=" << timeout << "]...";
+  std::array<::epoll_event, 16> events;
+  const int size =
+      ::epoll_wait(epollFd_.get(), events.data(), events.size(), timeout);
+  if (size < 0) {
+    if (errno == EINTR) return;
+    BOOST_THROW_EXCEPTION(SystemError("epoll_wait"));
+  }
+  for (int i = 0; i < size; ++i) {
+    const int fd = events[i].data.fd;
+    if (fd == signalFd_.get()) {
+      drain<::signalfd_siginfo>(fd);
+      reapChildren();
+    } else if (fd == timerFd_.get()) {
+      drain<std::uint64_t>(fd);
+    } else {
+      // handler may have been removed by previous one
+      const auto iter = descriptorHandlers_.find(fd);
+      if (iter != descriptorHandlers_.end()) {
+        // copy: handler may remove itself
+        const DescriptorHandler handler = iter->second;
+        handler();
+      }
+    }
+  }
+}
+
+void EventLoop::setDeadline(const TimePoint &deadline) {
+  ::itimerspec spec = {};
+  if (deadline != TimePoint()) {
+    const auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           deadline.time_since_epoch()).count();
+    spec.it_value.tv_sec = nanos / 1000000000;
+    spec.it_value.tv_nsec = nanos % 1000000000;
+  }
+  // zero it_value disarms timer
+  if (::timerfd_settime(timerFd_.get(), TFD_TIMER_ABSTIME, &spec, nullptr) < 0)
+    BOOST_THROW_EXCEPTION(SystemError("timerfd_settime"));
+}
+
+void EventLoop::reapChildren() {
+  // SIGCHLD is not queued, so several children may be waited for
+  for (;;) {
+    int statLoc;
+    const Pid pid = ::waitpid(-1, &statLoc, WNOHANG);
+    if (pid == 0) return;
+    if (pid < 0) {
+      if (errno == EINTR) continue;
+      if (errno == ECHILD) return;
+      BOOST_THROW_EXCEPTION(SystemError("waitpid")
+                            << Error::message("Undocumented error."));
+    }
+    STREAM_TRACE << "Child has terminated pid = " << pid << ".";
+    childHandler_(pid, statLoc);
+  }
+}
+
+void EventLoop::addToEpoll(const int fd, const std::uint32_t events) {
+  ::epoll_event event = {};
+  event.events = events;
+  event.data.fd = fd;
+  if (::epoll_ctl(epollFd_.get(), EPOLL_CTL_ADD, fd, &event) < 0)
+    BOOST_THROW_EXCEPTION(SystemError("epoll_ctl"));
+}
+
+}  // namespace async_process_group_detail
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
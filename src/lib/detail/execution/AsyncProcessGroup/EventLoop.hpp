@@ -0,0 +1,98 @@
+#pragma once
+
+#include "ProcessInfo.hpp"
+
+#include <yandex/contest/system/unistd/Descriptor.hpp>
+
+#include <boost/noncopyable.hpp>
+
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+
+#include <cstdint>
+
+#include <signal.h>
+#include <sys/epoll.h>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+namespace async_process_group_detail {
+
+/*!
+ * \brief Waits for child termination, deadlines
+ * and descriptor events in a single epoll(7) set.
+ *
+ * SIGCHLD is received through signalfd(2),
+ * deadlines are implemented by timerfd_create(2).
+ *
+ * \warning SIGCHLD is blocked for the calling thread
+ * while EventLoop is alive, so it should be created
+ * before any other thread or child process.
+ */
+class EventLoop : private boost::noncopyable {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using TimePoint = Clock::time_point;
+
+  using ChildHandler = std::function<void(Pid, int)>;
+  using DescriptorHandler = std::function<void()>;
+
+ public:
+  explicit EventLoop(const ChildHandler &childHandler);
+
+  ~EventLoop();
+
+  /*!
+   * \brief Call handler every time fd reports one of events.
+   *
+   * \param events epoll(7) events, e.g. EPOLLPRI for cgroup v2 files.
+   *
+   * \note EventLoop does not own fd.
+   */
+  void addDescriptor(int fd, const DescriptorHandler &handler,
+                     std::uint32_t events = EPOLLIN);
+
+  void removeDescriptor(int fd);
+
+  /*!
+   * \brief Wait for events and dispatch them.
+   *
+   * Returns after at least one event was dispatched
+   * or when deadline was reached.
+   */
+  void runUntil(const TimePoint &deadline);
+
+  /// runUntil() without deadline.
+  void run();
+
+  /// Signal mask that was active before EventLoop construction.
+  const ::sigset_t &originalSignalMask() const { return originalSignalMask_; }
+
+ private:
+  void wait(int timeout);
+
+  void setDeadline(const TimePoint &deadline);
+
+  void reapChildren();
+
+  void addToEpoll(int fd, std::uint32_t events = EPOLLIN);
+
+ private:
+  ::sigset_t originalSignalMask_;
+  system::unistd::Descriptor epollFd_;
+  system::unistd::Descriptor signalFd_;
+  system::unistd::Descriptor timerFd_;
+  ChildHandler childHandler_;
+  std::unordered_map<int, DescriptorHandler> descriptorHandlers_;
+};
+
+}  // namespace async_process_group_detail
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
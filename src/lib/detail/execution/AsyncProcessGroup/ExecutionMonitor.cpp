@@ -4,6 +4,10 @@
 
 #include <boost/assert.hpp>
 
+#include <algorithm>
+#include <limits>
+#include <string>
+
 #include <signal.h>
 
 namespace yandex {
@@ -13,6 +17,27 @@ namespace detail {
 namespace execution {
 namespace async_process_group_detail {
 
+namespace {
+template <typename Limit, typename Usage>
+ExecutionMonitor::Duration remaining(const Limit &limit, const Usage &usage) {
+  if (limit <= usage) return ExecutionMonitor::Duration::zero();
+  return std::chrono::duration_cast<ExecutionMonitor::Duration>(limit - usage);
+}
+}  // namespace
+
+const ExecutionMonitor::Duration ExecutionMonitor::minCheckInterval =
+    std::chrono::duration_cast<ExecutionMonitor::Duration>(
+        std::chrono::milliseconds(1));
+
+const ExecutionMonitor::Duration
+    ExecutionMonitor::instructionLimitCheckInterval =
+        std::chrono::duration_cast<ExecutionMonitor::Duration>(
+            std::chrono::milliseconds(10));
+
+const ExecutionMonitor::Duration ExecutionMonitor::memoryUsageSampleInterval =
+    std::chrono::duration_cast<ExecutionMonitor::Duration>(
+        std::chrono::milliseconds(10));
+
 void ExecutionMonitor::started(ProcessInfo &processInfo,
                                const AsyncProcessGroup::Process &process) {
   const std::size_t id = processInfo.id();
@@ -23,6 +48,11 @@ void ExecutionMonitor::started(ProcessInfo &processInfo,
   running_.insert(id);
   if (process.groupWaitsForTermination) groupWaitsForTermination_.insert(id);
   if (process.terminateGroupOnCrash) terminateGroupOnCrash_.insert(id);
+  const TimePoint now = Clock::now();
+  startPoints_[id] = now;
+  idleStates_[id].since = idleStates_[id].lastCheck = now;
+  timeLimitsCheckPoints_[id] =
+      timeLimitsCheckPoint(processInfo, now, process::ResourceUsage());
 
   signals_.spawn(processInfo.meta());
 }
@@ -73,12 +103,19 @@ void ExecutionMonitor::terminated(ProcessInfo &processInfo, const int statLoc) {
     }
   }
 
+  // cgroup outlives its processes, counters are meaningful whatever
+  // the completion status is, e.g. output written before SIGXFSZ
+  processInfo.fillIoUsage(processResult.resourceUsage);
+
   switch (processResult.completionStatus) {
     // if !START_FAILED data is meaningful,
     // moreover, START_FAILED should not be rewritten
     case process::Result::CompletionStatus::TERMINATED_BY_SYSTEM:
     case process::Result::CompletionStatus::ABNORMAL_EXIT:
     case process::Result::CompletionStatus::OK:
+      // statistics are cumulative, no need to read them while running
+      processInfo.fillContentionUsage(processResult.resourceUsage);
+      processInfo.fillMemoryUsage(processResult.resourceUsage);
       collectResourceInfo(processInfo);
       break;
     default:
@@ -118,10 +155,135 @@ void ExecutionMonitor::realTimeLimitExceeded() {
 }
 
 bool ExecutionMonitor::runOutOfResourceLimits(ProcessInfo &processInfo) {
+  const std::size_t id = processInfo.id();
+  const TimePoint now = Clock::now();
+
+  // memory usage is updated by MemoryUsageWatcher
+  // or sampled at check point, no need to read cgroup
+  if (processInfo.maxMemoryUsageBytes() <=
+          resourceLimits_[id].memoryLimitBytes &&
+      now < timeLimitsCheckPoints_[id]) {
+    return false;
+  }
+
   STREAM_TRACE << "Check if " << processInfo << " "
                << "run out of resource limits.";
-  return collectResourceInfo(processInfo) !=
-         process::Result::CompletionStatus::OK;
+  // memory notifications are not precise, we are reading cgroup anyway
+  processInfo.updateMaxMemoryUsageFromMemoryStat();
+  if (collectResourceInfo(processInfo) !=
+      process::Result::CompletionStatus::OK) {
+    return true;
+  }
+  const process::ResourceUsage &resourceUsage =
+      result_.processResults[id].resourceUsage;
+  if (idleTimeLimitExceeded(processInfo, now, resourceUsage)) {
+    STREAM_TRACE << processInfo << " run out of idle time limit.";
+    result_.processResults[id].completionStatus =
+        process::Result::CompletionStatus::IDLE_TIME_LIMIT_EXCEEDED;
+    return true;
+  }
+  timeLimitsCheckPoints_[id] =
+      timeLimitsCheckPoint(processInfo, now, resourceUsage);
+  return false;
+}
+
+ExecutionMonitor::TimePoint ExecutionMonitor::timeLimitsCheckPoint(
+    const ProcessInfo &processInfo) const {
+  return timeLimitsCheckPoints_[processInfo.id()];
+}
+
+ExecutionMonitor::Duration ExecutionMonitor::timeLimitsMargin(
+    const ProcessInfo &processInfo,
+    const process::ResourceUsage &resourceUsage) const {
+  const process::ResourceLimits &resourceLimits =
+      resourceLimits_[processInfo.id()];
+  const Duration margin =
+      std::min({remaining(resourceLimits.timeLimit, resourceUsage.timeUsage),
+                remaining(resourceLimits.userTimeLimit,
+                          resourceUsage.userTimeUsage),
+                remaining(resourceLimits.systemTimeLimit,
+                          resourceUsage.systemTimeUsage)});
+  BOOST_ASSERT(processInfo.cpuNumber() > 0);
+  const auto cpuNumber = static_cast<Duration::rep>(processInfo.cpuNumber());
+  return std::max(margin / cpuNumber, minCheckInterval);
+}
+
+ExecutionMonitor::TimePoint ExecutionMonitor::realTimeLimitPoint(
+    const ProcessInfo &processInfo) const {
+  const std::size_t id = processInfo.id();
+  return startPoints_[id] + std::chrono::duration_cast<Duration>(
+                                resourceLimits_[id].realTimeLimit);
+}
+
+ExecutionMonitor::TimePoint ExecutionMonitor::timeLimitsCheckPoint(
+    const ProcessInfo &processInfo, const TimePoint now,
+    const process::ResourceUsage &resourceUsage) const {
+  const std::size_t id = processInfo.id();
+  const IdleState &idle = idleStates_[id];
+  if (idle.groupCheck) return now;
+  TimePoint checkPoint =
+      std::min({now + timeLimitsMargin(processInfo, resourceUsage),
+                realTimeLimitPoint(processInfo),
+                idle.since + std::chrono::duration_cast<Duration>(
+                                 resourceLimits_[id].idleTimeLimit)});
+  // instruction rate is unknown, counters are polled
+  if (resourceLimits_[id].instructionLimit !=
+      std::numeric_limits<std::uint64_t>::max())
+    checkPoint = std::min(checkPoint, now + instructionLimitCheckInterval);
+  // memory usage is sampled by runOutOfResourceLimits()
+  if (processInfo.memoryUsageIsPolled())
+    checkPoint = std::min(checkPoint, now + memoryUsageSampleInterval);
+  return checkPoint;
+}
+
+bool ExecutionMonitor::idleTimeLimitExceeded(
+    const ProcessInfo &processInfo, const TimePoint now,
+    const process::ResourceUsage &resourceUsage) {
+  const std::size_t id = processInfo.id();
+  const process::ResourceLimits &resourceLimits = resourceLimits_[id];
+  IdleState &idle = idleStates_[id];
+  const auto resetIdle = [&] {
+    idle.since = now;
+    idle.timeUsage = resourceUsage.timeUsage;
+    idle.groupCheck = false;
+  };
+
+  const auto wallTime =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now - idle.since);
+  const auto cpuTime = resourceUsage.timeUsage - idle.timeUsage;
+  idle.lastCheck = now;
+  idle.idle = cpuTime.count() <
+              resourceLimits.idleCpuUsageRatio * wallTime.count();
+  if (!idle.idle) {
+    resetIdle();
+    return false;
+  }
+  if (wallTime < resourceLimits.idleTimeLimit) return false;
+
+  if (idleOnlyIfGroupIsIdle_) {
+    if (!idle.groupCheck) {
+      STREAM_TRACE << processInfo << " is idle, checking other processes.";
+      // force check of other processes, see timeLimitsCheckPoint()
+      idle.groupCheck = true;
+      idle.groupCheckStart = now;
+      for (const Id other : running_) timeLimitsCheckPoints_[other] = now;
+      return false;
+    }
+    for (const Id other : running_) {
+      if (other != id && idleStates_[other].lastCheck < idle.groupCheckStart)
+        return false;  // not checked yet
+    }
+    for (const Id other : running_) {
+      if (other != id && !idleStates_[other].idle) {
+        STREAM_TRACE << processInfo << " waits for running process.";
+        resetIdle();
+        return false;
+      }
+    }
+    idle.groupCheck = false;
+  }
+  idle.exceeded = true;
+  return true;
 }
 
 process::Result::CompletionStatus ExecutionMonitor::collectResourceInfo(
@@ -135,6 +297,13 @@ process::Result::CompletionStatus ExecutionMonitor::collectResourceInfo(
   process::ResourceUsage &resourceUsage = result.resourceUsage;
   const process::ResourceLimits &resourceLimits = resourceLimits_[id];
   processInfo.fillResourceUsage(resourceUsage);
+  // terminated by system processes are killed by us, not by oom-killer
+  resourceUsage.oomKills = processInfo.oomKills(
+      result.termSig && result.termSig.get() == SIGKILL &&
+      status != process::Result::CompletionStatus::TERMINATED_BY_SYSTEM);
+  resourceUsage.realTimeUsage =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                           startPoints_[id]);
   if (resourceUsage.timeUsage > resourceLimits.timeLimit) {
     STREAM_TRACE << processInfo << " run out of time limit.";
     return status = process::Result::CompletionStatus::TIME_LIMIT_EXCEEDED;
@@ -148,10 +317,37 @@ process::Result::CompletionStatus ExecutionMonitor::collectResourceInfo(
     return status =
                process::Result::CompletionStatus::SYSTEM_TIME_LIMIT_EXCEEDED;
   }
+  if (resourceUsage.realTimeUsage >= resourceLimits.realTimeLimit) {
+    STREAM_TRACE << processInfo << " run out of real time limit.";
+    return status = process::Result::CompletionStatus::REAL_TIME_LIMIT_EXCEEDED;
+  }
+  if (resourceUsage.oomKills) {
+    STREAM_TRACE << processInfo << " was killed by oom-killer.";
+    return status = process::Result::CompletionStatus::MEMORY_LIMIT_EXCEEDED;
+  }
   if (resourceUsage.memoryUsageBytes > resourceLimits.memoryLimitBytes) {
     STREAM_TRACE << processInfo << " run out of memory limit.";
     return status = process::Result::CompletionStatus::MEMORY_LIMIT_EXCEEDED;
   }
+  if (resourceLimits.instructionLimit !=
+      std::numeric_limits<std::uint64_t>::max()) {
+    // counter is opened if limit is set, it is not available
+    // only if some instructions were not counted,
+    // that is failure of measurement, not of the process
+    if (!resourceUsage.instructions) {
+      STREAM_ERROR << processInfo << " instructions were not counted, "
+                   << "instruction limit can't be verified.";
+      instructionsNotCounted_.insert(id);
+      return status = process::Result::CompletionStatus::TERMINATED_BY_SYSTEM;
+    }
+    if (*resourceUsage.instructions > resourceLimits.instructionLimit) {
+      STREAM_TRACE << processInfo << " run out of instruction limit.";
+      return status =
+                 process::Result::CompletionStatus::INSTRUCTION_LIMIT_EXCEEDED;
+    }
+  }
+  if (idleStates_[id].exceeded)
+    return status = process::Result::CompletionStatus::IDLE_TIME_LIMIT_EXCEEDED;
   // note: do not overwrite by OK
   return process::Result::CompletionStatus::OK;
 }
@@ -162,6 +358,15 @@ const AsyncProcessGroup::Result &ExecutionMonitor::result() const {
   BOOST_ASSERT(running_.size() + terminated_.size() ==
                result_.processResults.size());
   BOOST_ASSERT(terminated_.size() == result_.processResults.size());
+  if (!instructionsNotCounted_.empty()) {
+    const Id id = *std::min_element(instructionsNotCounted_.begin(),
+                                    instructionsNotCounted_.end());
+    BOOST_THROW_EXCEPTION(
+        AsyncProcessGroupError()
+        << Error::message("Instructions of process " + std::to_string(id) +
+                          " were not counted completely, "
+                          "instruction limit can't be verified."));
+  }
   return result_;
 }
 
@@ -9,6 +9,7 @@
 
 #include <boost/noncopyable.hpp>
 
+#include <chrono>
 #include <unordered_set>
 
 namespace yandex {
@@ -22,9 +23,18 @@ using Id = std::size_t;
 
 class ExecutionMonitor : private boost::noncopyable {
  public:
-  explicit ExecutionMonitor(
-      const std::vector<AsyncProcessGroup::Process> &processes)
-      : resourceLimits_(processes.size()) {
+  using Clock = std::chrono::steady_clock;
+  using TimePoint = Clock::time_point;
+  using Duration = Clock::duration;
+
+ public:
+  ExecutionMonitor(const std::vector<AsyncProcessGroup::Process> &processes,
+                   const process_group::ResourceLimits &resourceLimits)
+      : idleOnlyIfGroupIsIdle_(resourceLimits.idleOnlyIfGroupIsIdle),
+        resourceLimits_(processes.size()),
+        timeLimitsCheckPoints_(processes.size()),
+        startPoints_(processes.size()),
+        idleStates_(processes.size()) {
     for (std::size_t i = 0; i < processes.size(); ++i)
       resourceLimits_[i] = processes[i].resourceLimits;
     result_.processGroupResult.completionStatus =
@@ -47,19 +57,42 @@ class ExecutionMonitor : private boost::noncopyable {
   /// Notify monitor that real time limit was exceeded.
   void realTimeLimitExceeded();
 
+  /*!
+   * \brief Check if process has run out of resource limits.
+   *
+   * Memory limit is checked every time.
+   * Time limits (including real and idle time limits)
+   * are checked only if timeLimitsCheckPoint()
+   * was reached, check point is recomputed after that.
+   */
   bool runOutOfResourceLimits(ProcessInfo &processInfo);
 
+  /*!
+   * \brief Earliest moment process may exceed one of time limits.
+   *
+   * Never later than process real time limit deadline
+   * and the moment process may exceed idle time limit.
+   *
+   * \see runOutOfResourceLimits()
+   */
+  TimePoint timeLimitsCheckPoint(const ProcessInfo &processInfo) const;
+
   process::Result::CompletionStatus collectResourceInfo(
       ProcessInfo &processInfo);
 
   bool processGroupIsRunning() const {
     return result_.processGroupResult.completionStatus ==
                process_group::Result::CompletionStatus::OK &&
-           !groupWaitsForTermination_.empty();
+           !groupWaitsForTermination_.empty() &&
+           instructionsNotCounted_.empty();
   }
 
   bool processesAreRunning() const { return !running_.empty(); }
 
+  /*!
+   * \throws AsyncProcessGroupError if result can't be trusted:
+   * instructions of process with instruction limit were not counted.
+   */
   const AsyncProcessGroup::Result &result() const;
 
   const std::unordered_set<Id> &running() const { return running_; }
@@ -80,11 +113,71 @@ class ExecutionMonitor : private boost::noncopyable {
   }
 
  private:
+  /*!
+   * \brief Minimal amount of wall time process needs
+   * to exceed one of time limits given current resource usage.
+   *
+   * Process can not consume more than cpuNumber
+   * seconds of CPU time during one second of wall time.
+   */
+  Duration timeLimitsMargin(const ProcessInfo &processInfo,
+                            const process::ResourceUsage &resourceUsage) const;
+
+  /// Moment process exceeds its real time limit.
+  TimePoint realTimeLimitPoint(const ProcessInfo &processInfo) const;
+
+  TimePoint timeLimitsCheckPoint(
+      const ProcessInfo &processInfo, TimePoint now,
+      const process::ResourceUsage &resourceUsage) const;
+
+  /*!
+   * \brief Update idle state and check idle time limit.
+   *
+   * If other processes should be idle too
+   * their states are refreshed before the decision.
+   *
+   * \see process_group::ResourceLimits::idleOnlyIfGroupIsIdle
+   */
+  bool idleTimeLimitExceeded(const ProcessInfo &processInfo, TimePoint now,
+                             const process::ResourceUsage &resourceUsage);
+
+ private:
+  /// Check points are not computed more often.
+  static const Duration minCheckInterval;
+
+  /// How often instruction counters are checked against limit.
+  static const Duration instructionLimitCheckInterval;
+
+  /// \see ProcessInfo::memoryUsageIsPolled()
+  static const Duration memoryUsageSampleInterval;
+
+ private:
+  struct IdleState {
+    /// Beginning of the period without CPU progress.
+    TimePoint since;
+    std::chrono::nanoseconds timeUsage{0};
+
+    /// Process had no CPU progress at lastCheck.
+    bool idle = false;
+    TimePoint lastCheck;
+
+    /// Other processes are being checked since this moment.
+    bool groupCheck = false;
+    TimePoint groupCheckStart;
+
+    bool exceeded = false;
+  };
+
+ private:
+  const bool idleOnlyIfGroupIsIdle_;
   Notifier::Signals signals_;
   std::vector<process::ResourceLimits> resourceLimits_;
+  std::vector<TimePoint> timeLimitsCheckPoints_;
+  std::vector<TimePoint> startPoints_;
+  std::vector<IdleState> idleStates_;
   AsyncProcessGroup::Result result_;
   std::unordered_set<Id> running_, terminated_, terminateGroupOnCrash_,
-      groupWaitsForTermination_;
+      groupWaitsForTermination_, instructionsNotCounted_;
 };
 
 }  // namespace async_process_group_detail
@@ -0,0 +1,308 @@
+#include "LegacyControlGroup.hpp"
+
+#include <yandex/contest/system/cgroup/CpuAccounting.hpp>
+#include <yandex/contest/system/cgroup/CpuSet.hpp>
+#include <yandex/contest/system/cgroup/Freezer.hpp>
+#include <yandex/contest/system/cgroup/Memory.hpp>
+#include <yandex/contest/system/cgroup/MemorySwap.hpp>
+#include <yandex/contest/system/cgroup/MultipleControlGroup.hpp>
+#include <yandex/contest/system/cgroup/SystemInfo.hpp>
+#include <yandex/contest/system/cgroup/Termination.hpp>
+
+#include <yandex/contest/StreamLog.hpp>
+#include <yandex/contest/SystemError.hpp>
+
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/assert.hpp>
+
+#include <chrono>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include <cerrno>
+
+#include <linux/magic.h>
+#include <signal.h>
+#include <sys/vfs.h>
+
+#ifndef CGROUP2_SUPER_MAGIC
+#define CGROUP2_SUPER_MAGIC 0x63677270
+#endif
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+namespace async_process_group_detail {
+
+ProcessControlGroupPointer LegacyControlGroup::forSelf() {
+  const char *const subsystems[] = {"cpuacct", "cpuset", "freezer", "memory"};
+  const auto sys = system::cgroup::SystemInfo::instance();
+  std::set<std::size_t> hierarchies;
+  for (const char *const subsystem : subsystems)
+    hierarchies.insert(sys->bySubsystem(subsystem).id);
+  return std::make_shared<LegacyControlGroup>(
+      system::cgroup::MultipleControlGroup::forSelf(hierarchies.begin(),
+                                                    hierarchies.end()));
+}
+
+LegacyControlGroup::LegacyControlGroup(
+    const system::cgroup::ControlGroupPointer &controlGroup)
+    : controlGroup_(controlGroup) {
+  BOOST_ASSERT(controlGroup_);
+}
+
+ProcessControlGroupPointer LegacyControlGroup::createChild(
+    const std::string &name) {
+  return std::make_shared<LegacyControlGroup>(
+      controlGroup_->createChild(name, 0700));
+}
+
+void LegacyControlGroup::configure() {
+  const system::cgroup::CpuSet parentCpuSet(controlGroup_->parent()),
+      cpuSet(controlGroup_);
+  cpuSet.setCpus(parentCpuSet.cpus());
+  cpuSet.setMems(parentCpuSet.mems());
+
+  const system::cgroup::Memory memory(controlGroup_);
+
+  // we do not want to count memory used by control process
+  cpuSet.setMemoryMigrate(false);
+  memory.setMoveChargeAtImmigrate(false, false);
+
+  // we need oom-killer
+  if (memory.oomKillDisable()) memory.setOomKillDisable(false);
+  oomKillsBase_ = totalOomKills().value_or(0);
+}
+
+bool LegacyControlGroup::reset() {
+  if (!empty()) return false;
+  // uncharge page cache left by previous run
+  controlGroup_->writeField("memory.force_empty", 0);
+  controlGroup_->writeField("memory.max_usage_in_bytes", 0);
+  if (peakMemorySwapUsage())
+    controlGroup_->writeField("memory.memsw.max_usage_in_bytes", 0);
+  controlGroup_->writeField("memory.failcnt", 0);
+  controlGroup_->writeField("cpuacct.usage", 0);
+  // previous run may have been pinned
+  setCpus(system::cgroup::CpuSet(controlGroup_->parent()).cpus());
+  oomKillsBase_ = totalOomKills().value_or(0);
+  return true;
+}
+
+std::string LegacyControlGroup::cpus() const {
+  return system::cgroup::CpuSet(controlGroup_).cpus();
+}
+
+void LegacyControlGroup::setCpus(const std::string &cpus) {
+  system::cgroup::CpuSet(controlGroup_).setCpus(cpus);
+}
+
+std::string LegacyControlGroup::mems() const {
+  return system::cgroup::CpuSet(controlGroup_).mems();
+}
+
+bool LegacyControlGroup::empty() const {
+  return controlGroup_->tasks().empty();
+}
+
+void LegacyControlGroup::attachSelf() { controlGroup_->attachSelf(); }
+
+std::vector<boost::filesystem::path> LegacyControlGroup::attachFiles() const {
+  std::set<boost::filesystem::path> controlGroups;
+  for (const char *const field :
+       {"cpuacct.usage", "cpuset.cpus", "freezer.state", "memory.stat"})
+    controlGroups.insert(controlGroup_->fieldPath(field).parent_path());
+  std::vector<boost::filesystem::path> files;
+  for (const boost::filesystem::path &controlGroup : controlGroups)
+    files.push_back(controlGroup / "tasks");
+  return files;
+}
+
+boost::filesystem::path LegacyControlGroup::cloneIntoPath() const {
+  boost::filesystem::path path;
+  try {
+    // is not defined for control group spanning several v1 hierarchies
+    path = controlGroup_->fieldPath("cgroup.procs").parent_path();
+  } catch (std::exception &) {
+    return boost::filesystem::path();
+  }
+  struct ::statfs fs;
+  if (::statfs(path.c_str(), &fs) < 0)
+    BOOST_THROW_EXCEPTION(SystemError("statfs"));
+  if (fs.f_type != CGROUP2_SUPER_MAGIC) return boost::filesystem::path();
+  return path;
+}
+
+boost::filesystem::path LegacyControlGroup::perfEventPath() const {
+  // perf_event v1 hierarchy is not used
+  return cloneIntoPath();
+}
+
+void LegacyControlGroup::terminate() {
+  if (empty()) return;
+  // frozen processes can't fork, so single pass is enough
+  const system::cgroup::Freezer freezer(controlGroup_);
+  const auto frozen = [this] {
+    return boost::algorithm::trim_copy(
+               controlGroup_->readField<std::string>("freezer.state")) ==
+           "FROZEN";
+  };
+  freezer.freeze();
+  try {
+    // tasks in uninterruptible sleep may delay freezing,
+    // SIGKILL is delivered to them anyway
+    if (!waitUntil(frozen))
+      STREAM_DEBUG << *controlGroup_ << " has not been frozen in time.";
+    for (const pid_t pid : controlGroup_->tasks()) {
+      if (::kill(pid, SIGKILL) < 0 && errno != ESRCH)
+        BOOST_THROW_EXCEPTION(SystemError("kill"));
+    }
+  } catch (...) {
+    freezer.unfreeze();
+    throw;
+  }
+  freezer.unfreeze();
+  if (!waitUntil([this] { return empty(); })) {
+    STREAM_ERROR << "Killed processes of " << *controlGroup_ << " "
+                 << "have not exited in time, killing again.";
+    system::cgroup::terminate(controlGroup_);
+  }
+}
+
+bool LegacyControlGroup::waitUntil(const std::function<bool()> &ready) const {
+  const auto deadline = std::chrono::steady_clock::now() + terminationTimeout;
+  while (!ready()) {
+    if (std::chrono::steady_clock::now() >= deadline) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+ProcessControlGroup::CpuUsage LegacyControlGroup::cpuUsage() const {
+  const system::cgroup::CpuAccounting cpuAcct(controlGroup_);
+  const auto cpuAcctStat = cpuAcct.stat();
+  CpuUsage usage;
+  usage.user = cpuAcctStat.userUsage;
+  usage.system = cpuAcctStat.systemUsage;
+  usage.total = cpuAcct.usage();
+  return usage;
+}
+
+boost::optional<ProcessControlGroup::Pressure> LegacyControlGroup::pressure(
+    const std::string & /*resource*/) const {
+  // pressure stall information is provided for cgroup v2 only
+  return boost::none;
+}
+
+boost::optional<ProcessControlGroup::CpuThrottling>
+LegacyControlGroup::cpuThrottling() const {
+  // cpu v1 hierarchy is not used
+  return boost::none;
+}
+
+boost::optional<ProcessControlGroup::IoUsage> LegacyControlGroup::ioUsage()
+    const {
+  // blkio v1 hierarchy is not used
+  return boost::none;
+}
+
+void LegacyControlGroup::setIoLimits(const IoLimits & /*ioLimits*/) {
+  BOOST_THROW_EXCEPTION(Error() << Error::message(
+                            "I/O limits require cgroup v2 hierarchy."));
+}
+
+ProcessControlGroup::MemoryStat LegacyControlGroup::memoryStat() const {
+  const auto stat = system::cgroup::Memory(controlGroup_).stat();
+  const auto get = [&stat](const std::string &key) -> std::uint64_t {
+    const auto iter = stat.find(key);
+    return iter == stat.end() ? 0 : iter->second;
+  };
+  MemoryStat memoryStat;
+  memoryStat.anonymous = get("rss");
+  memoryStat.pageCache = get("cache");
+  memoryStat.shared = get("shmem");
+  memoryStat.swap = get("swap");
+  try {
+    memoryStat.kernel =
+        controlGroup_->readField<std::uint64_t>("memory.kmem.usage_in_bytes");
+  } catch (std::exception &) {
+    // kernel memory accounting is not available
+  }
+  return memoryStat;
+}
+
+boost::optional<std::uint64_t> LegacyControlGroup::peakMemoryUsage() const {
+  return system::cgroup::Memory(controlGroup_).maxUsage();
+}
+
+boost::optional<std::uint64_t> LegacyControlGroup::peakMemorySwapUsage()
+    const {
+  try {
+    return system::cgroup::MemorySwap(controlGroup_).maxUsage();
+  } catch (std::exception &) {
+    // kernel is booted without swapaccount=1
+    return boost::none;
+  }
+}
+
+void LegacyControlGroup::setMemoryLimit(const std::uint64_t memoryLimitBytes) {
+  // pooled control group may keep limit of previous process
+  const std::uint64_t unlimited = std::numeric_limits<std::int64_t>::max();
+  system::cgroup::Memory(controlGroup_)
+      .setLimit(std::min(memoryLimitBytes, unlimited));
+}
+
+boost::optional<std::uint64_t> LegacyControlGroup::oomKills() const {
+  if (const auto total = totalOomKills()) return *total - oomKillsBase_;
+  return boost::none;
+}
+
+std::uint64_t LegacyControlGroup::memoryLimitHits() const {
+  // reset by reset(), zero for new control group
+  return controlGroup_->readField<std::uint64_t>("memory.failcnt");
+}
+
+boost::optional<std::uint64_t> LegacyControlGroup::totalOomKills() const {
+  std::istringstream in(
+      controlGroup_->readField<std::string>("memory.oom_control"));
+  std::string key;
+  std::uint64_t value;
+  // "oom_kill" is available since Linux 4.13
+  while (in >> key >> value)
+    if (key == "oom_kill") return value;
+  return boost::none;
+}
+
+std::unique_ptr<MemoryUsageWatcher> LegacyControlGroup::watchMemoryUsage(
+    const std::uint64_t memoryLimitBytes) {
+  return std::unique_ptr<MemoryUsageWatcher>(
+      new MemoryUsageWatcher(controlGroup_, memoryLimitBytes));
+}
+
+void LegacyControlGroup::freeze() {
+  system::cgroup::Freezer(controlGroup_).freeze();
+}
+
+void LegacyControlGroup::unfreeze() {
+  system::cgroup::Freezer(controlGroup_).unfreeze();
+}
+
+void LegacyControlGroup::writeField(const std::string &field,
+                                    const std::string &value) {
+  controlGroup_->writeField(field, value);
+}
+
+void LegacyControlGroup::print(std::ostream &out) const {
+  out << *controlGroup_;
+}
+
+}  // namespace async_process_group_detail
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
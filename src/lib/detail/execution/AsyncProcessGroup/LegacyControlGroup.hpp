@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ProcessControlGroup.hpp"
+
+#include <yandex/contest/system/cgroup/ControlGroup.hpp>
+
+#include <functional>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+namespace async_process_group_detail {
+
+/// ProcessControlGroup spanning cgroup v1 hierarchies.
+class LegacyControlGroup : public ProcessControlGroup {
+ public:
+  /// In cpuacct, cpuset, freezer and memory hierarchies.
+  static ProcessControlGroupPointer forSelf();
+
+  explicit LegacyControlGroup(
+      const system::cgroup::ControlGroupPointer &controlGroup);
+
+  ProcessControlGroupPointer createChild(const std::string &name) override;
+  void configure() override;
+  bool reset() override;
+  std::string cpus() const override;
+  void setCpus(const std::string &cpus) override;
+  std::string mems() const override;
+  bool empty() const override;
+  void attachSelf() override;
+  std::vector<boost::filesystem::path> attachFiles() const override;
+  boost::filesystem::path cloneIntoPath() const override;
+  boost::filesystem::path perfEventPath() const override;
+  void terminate() override;
+  CpuUsage cpuUsage() const override;
+  boost::optional<Pressure> pressure(
+      const std::string &resource) const override;
+  boost::optional<CpuThrottling> cpuThrottling() const override;
+  boost::optional<IoUsage> ioUsage() const override;
+  void setIoLimits(const IoLimits &ioLimits) override;
+  MemoryStat memoryStat() const override;
+  boost::optional<std::uint64_t> peakMemoryUsage() const override;
+  boost::optional<std::uint64_t> peakMemorySwapUsage() const override;
+  void setMemoryLimit(std::uint64_t memoryLimitBytes) override;
+  boost::optional<std::uint64_t> oomKills() const override;
+  std::uint64_t memoryLimitHits() const override;
+  std::unique_ptr<MemoryUsageWatcher> watchMemoryUsage(
+      std::uint64_t memoryLimitBytes) override;
+  void freeze() override;
+  void unfreeze() override;
+  void writeField(const std::string &field,
+                  const std::string &value) override;
+  void print(std::ostream &out) const override;
+
+ private:
+  /// \return false if terminationTimeout has expired.
+  bool waitUntil(const std::function<bool()> &ready) const;
+
+  /*!
+   * \brief Counter from memory.oom_control, can't be reset.
+   *
+   * \return boost::none if it is not provided by kernel.
+   */
+  boost::optional<std::uint64_t> totalOomKills() const;
+
+ private:
+  system::cgroup::ControlGroupPointer controlGroup_;
+  std::uint64_t oomKillsBase_ = 0;
+};
+
+}  // namespace async_process_group_detail
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
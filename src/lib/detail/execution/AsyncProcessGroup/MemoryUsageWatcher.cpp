@@ -0,0 +1,107 @@
+#include "MemoryUsageWatcher.hpp"
+
+#include <yandex/contest/system/unistd/Operations.hpp>
+
+#include <yandex/contest/StreamLog.hpp>
+#include <yandex/contest/SystemError.hpp>
+
+#include <bunsan/filesystem/fstream.hpp>
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+namespace async_process_group_detail {
+
+const std::size_t MemoryUsageWatcher::thresholdsNumber = 32;
+
+const std::uint64_t MemoryUsageWatcher::minThresholdStepBytes = 1024 * 1024;
+
+namespace {
+int eventFd() {
+  const int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (fd < 0) BOOST_THROW_EXCEPTION(SystemError("eventfd"));
+  return fd;
+}
+}  // namespace
+
+MemoryUsageWatcher::MemoryUsageWatcher(
+    const system::cgroup::ControlGroupPointer &controlGroup,
+    const std::uint64_t memoryLimitBytes)
+    : eventFd_(eventFd()), events_(EPOLLIN) {
+  const boost::filesystem::path usagePath =
+      controlGroup->fieldPath("memory.usage_in_bytes");
+  usageFd_ = system::unistd::open(usagePath, O_RDONLY | O_CLOEXEC);
+  oomControlFd_ = system::unistd::open(
+      controlGroup->fieldPath("memory.oom_control"), O_RDONLY | O_CLOEXEC);
+
+  const std::uint64_t step =
+      std::max(memoryLimitBytes / thresholdsNumber, minThresholdStepBytes);
+  std::vector<std::uint64_t> thresholds;
+  for (std::uint64_t k = 1; k <= 2 * thresholdsNumber; ++k) {
+    if (step > std::numeric_limits<std::uint64_t>::max() / k) break;
+    thresholds.push_back(step * k);
+  }
+  // usage does not exceed the limit, it may never cross the next threshold
+  if (memoryLimitBytes < static_cast<std::uint64_t>(
+                             std::numeric_limits<std::int64_t>::max()))
+    thresholds.push_back(memoryLimitBytes);
+  std::sort(thresholds.begin(), thresholds.end());
+  thresholds.erase(std::unique(thresholds.begin(), thresholds.end()),
+                   thresholds.end());
+  STREAM_TRACE << "Registering memory usage thresholds "
+               << "with step = " << step << " for " << *controlGroup << ".";
+  // note: thresholds are unregistered when eventFd_ is closed
+  bunsan::filesystem::ofstream eventControl(usagePath.parent_path() /
+                                            "cgroup.event_control");
+  BUNSAN_FILESYSTEM_FSTREAM_WRAP_BEGIN(eventControl) {
+    for (const std::uint64_t threshold : thresholds) {
+      // each registration should be a separate write
+      eventControl << eventFd_.get() << ' ' << usageFd_.get() << ' '
+                   << threshold << std::flush;
+    }
+    eventControl << eventFd_.get() << ' ' << oomControlFd_.get() << std::flush;
+  } BUNSAN_FILESYSTEM_FSTREAM_WRAP_END(eventControl)
+  eventControl.close();
+}
+
+MemoryUsageWatcher::MemoryUsageWatcher(
+    const boost::filesystem::path &memoryEvents)
+    : eventFd_(system::unistd::open(memoryEvents, O_RDONLY | O_CLOEXEC)),
+      events_(EPOLLPRI) {}
+
+bool MemoryUsageWatcher::notifiesThresholds() const {
+  return events_ == EPOLLIN;
+}
+
+void MemoryUsageWatcher::acknowledge() {
+  if (events_ == EPOLLPRI) {
+    // kernfs notification is rearmed by reading
+    char buffer[256];
+    if (::pread(eventFd_.get(), buffer, sizeof(buffer), 0) < 0)
+      BOOST_THROW_EXCEPTION(SystemError("pread"));
+    return;
+  }
+  ::eventfd_t value;
+  if (::eventfd_read(eventFd_.get(), &value) < 0 && errno != EAGAIN)
+    BOOST_THROW_EXCEPTION(SystemError("eventfd_read"));
+}
+
+}  // namespace async_process_group_detail
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <yandex/contest/system/cgroup/ControlGroup.hpp>
+#include <yandex/contest/system/unistd/Descriptor.hpp>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <cstdint>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+namespace async_process_group_detail {
+
+/*!
+ * \brief Notifies when control group memory usage crosses thresholds.
+ *
+ * For cgroup v1 thresholds are evenly distributed up to twice
+ * the memory limit, one more is exactly at the limit.
+ * They are registered through cgroup.event_control
+ * on memory.usage_in_bytes, so fd() becomes readable
+ * every time usage crosses one of them.
+ * Invocation of oom-killer is registered on memory.oom_control.
+ *
+ * For cgroup v2 memory.events is watched, it is modified
+ * every time usage hits memory.max or oom-killer is invoked,
+ * memory usage below the limit should be sampled periodically.
+ *
+ * \note Memory usage includes page cache,
+ * notification only means that memory usage should be sampled
+ * together with kernel-maintained peak, see ProcessInfo.
+ *
+ * Watcher should be created before processes are started,
+ * usage growth before that is not notified.
+ */
+class MemoryUsageWatcher : private boost::noncopyable {
+ public:
+  MemoryUsageWatcher(const system::cgroup::ControlGroupPointer &controlGroup,
+                     std::uint64_t memoryLimitBytes);
+
+  /// \param memoryEvents cgroup v2 memory.events file.
+  explicit MemoryUsageWatcher(const boost::filesystem::path &memoryEvents);
+
+  /// Descriptor to be polled for events().
+  int fd() const { return eventFd_.get(); }
+
+  /// epoll(7) events, EPOLLIN or EPOLLPRI.
+  std::uint32_t events() const { return events_; }
+
+  /// Notifications are sent as usage grows, not only at the limit.
+  bool notifiesThresholds() const;
+
+  /// Acknowledge notification, should be called after fd() became readable.
+  void acknowledge();
+
+ private:
+  static const std::size_t thresholdsNumber;
+  static const std::uint64_t minThresholdStepBytes;
+
+ private:
+  system::unistd::Descriptor eventFd_;
+  system::unistd::Descriptor usageFd_;
+  system::unistd::Descriptor oomControlFd_;
+  std::uint32_t events_;
+};
+
+}  // namespace async_process_group_detail
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
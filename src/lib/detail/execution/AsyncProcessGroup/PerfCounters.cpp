@@ -0,0 +1,106 @@
+#include "PerfCounters.hpp"
+
+#include <yandex/contest/invoker/detail/CpuList.hpp>
+
+#include <yandex/contest/StreamLog.hpp>
+#include <yandex/contest/SystemError.hpp>
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+namespace async_process_group_detail {
+
+namespace {
+/// PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING
+struct CounterValue {
+  std::uint64_t value;
+  std::uint64_t timeEnabled;
+  std::uint64_t timeRunning;
+};
+}  // namespace
+
+PerfCounters::PerfCounters(const boost::filesystem::path &controlGroup,
+                           const std::string &cpus) {
+  const system::unistd::Descriptor cgroup(
+      ::open(controlGroup.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+  if (!cgroup) BOOST_THROW_EXCEPTION(SystemError("open"));
+  const std::vector<int> cpuIds = parseCpuList(cpus);
+  // instruction limit is enforced, counter is never multiplexed
+  open(instructions_, PERF_COUNT_HW_INSTRUCTIONS, true, cgroup.get(), cpuIds);
+  open(cycles_, PERF_COUNT_HW_CPU_CYCLES, false, cgroup.get(), cpuIds);
+  open(cacheMisses_, PERF_COUNT_HW_CACHE_MISSES, false, cgroup.get(),
+       cpuIds);
+}
+
+bool PerfCounters::countsInstructions() const {
+  return !instructions_.counters.empty();
+}
+
+void PerfCounters::fillResourceUsage(
+    process::ResourceUsage &resourceUsage) const {
+  resourceUsage.instructions = read(instructions_);
+  resourceUsage.cycles = read(cycles_);
+  resourceUsage.cacheMisses = read(cacheMisses_);
+}
+
+void PerfCounters::open(Event &event, const std::uint64_t config,
+                        const bool pinned, const int controlGroup,
+                        const std::vector<int> &cpus) {
+  ::perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  // kernel work depends on system load
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  // pinned counter that can't stay on PMU is put into error state
+  attr.pinned = pinned;
+  for (const int cpu : cpus) {
+    const int fd = ::syscall(SYS_perf_event_open, &attr, controlGroup, cpu, -1,
+                             PERF_FLAG_PID_CGROUP | PERF_FLAG_FD_CLOEXEC);
+    if (fd < 0) {
+      STREAM_DEBUG << "Hardware event " << config << " can't be counted "
+                   << "on CPU " << cpu << " (errno = " << errno << ").";
+      // partial sum is meaningless
+      event.counters.clear();
+      return;
+    }
+    event.counters.emplace_back(fd);
+  }
+}
+
+boost::optional<std::uint64_t> PerfCounters::read(const Event &event) {
+  if (event.counters.empty()) return boost::none;
+  std::uint64_t sum = 0;
+  for (const system::unistd::Descriptor &counter : event.counters) {
+    CounterValue value;
+    const ssize_t size = ::read(counter.get(), &value, sizeof(value));
+    if (size < 0) BOOST_THROW_EXCEPTION(SystemError("read"));
+    // end of file is returned for pinned counter in error state
+    if (size != sizeof(value)) return boost::none;
+    // counter was multiplexed with other events, scaled value is a guess
+    if (value.timeRunning < value.timeEnabled) return boost::none;
+    sum += value.value;
+  }
+  return sum;
+}
+
+}  // namespace async_process_group_detail
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
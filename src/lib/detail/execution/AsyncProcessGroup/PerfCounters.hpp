@@ -0,0 +1,73 @@
+#pragma once
+
+#include <yandex/contest/invoker/process/ResourceUsage.hpp>
+
+#include <yandex/contest/system/unistd/Descriptor.hpp>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+namespace async_process_group_detail {
+
+/*!
+ * \brief Hardware event counters of control group.
+ *
+ * Counters are opened by perf_event_open(2) with PERF_FLAG_PID_CGROUP,
+ * one per event per CPU available to control group.
+ * Only user space events are counted.
+ * Events not supported by hardware or kernel are skipped.
+ *
+ * Instruction counter is pinned to PMU, other counters may be
+ * multiplexed. Counts are never scaled: event which was not counted
+ * all the time it was enabled is reported as not counted.
+ */
+class PerfCounters : private boost::noncopyable {
+ public:
+  /*!
+   * \param controlGroup cgroup v2 directory.
+   * \param cpus CPUs in cpuset(7) list format.
+   *
+   * \see ProcessControlGroup::perfEventPath()
+   */
+  PerfCounters(const boost::filesystem::path &controlGroup,
+               const std::string &cpus);
+
+  /// Instruction counter is available.
+  bool countsInstructions() const;
+
+  /// Fill hardware event fields.
+  void fillResourceUsage(process::ResourceUsage &resourceUsage) const;
+
+ private:
+  struct Event {
+    /// Per-CPU counters, empty if not supported.
+    std::vector<system::unistd::Descriptor> counters;
+  };
+
+  void open(Event &event, std::uint64_t config, bool pinned,
+            int controlGroup, const std::vector<int> &cpus);
+
+  /// Sum over CPUs, boost::none if some counter has missed events.
+  static boost::optional<std::uint64_t> read(const Event &event);
+
+ private:
+  Event instructions_, cycles_, cacheMisses_;
+};
+
+}  // namespace async_process_group_detail
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
@@ -0,0 +1,34 @@
+#include "ProcessControlGroup.hpp"
+
+#include "LegacyControlGroup.hpp"
+#include "UnifiedControlGroup.hpp"
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+namespace async_process_group_detail {
+
+const std::chrono::milliseconds ProcessControlGroup::terminationTimeout =
+    std::chrono::seconds(5);
+
+ProcessControlGroupPointer ProcessControlGroup::forSelf() {
+  if (UnifiedControlGroup::mounted()) return UnifiedControlGroup::forSelf();
+  return LegacyControlGroup::forSelf();
+}
+
+ProcessControlGroup::~ProcessControlGroup() {}
+
+std::ostream &operator<<(std::ostream &out,
+                         const ProcessControlGroup &controlGroup) {
+  controlGroup.print(out);
+  return out;
+}
+
+}  // namespace async_process_group_detail
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
@@ -0,0 +1,239 @@
+#pragma once
+
+#include "MemoryUsageWatcher.hpp"
+
+#include <boost/filesystem/path.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+namespace async_process_group_detail {
+
+class ProcessControlGroup;
+using ProcessControlGroupPointer = std::shared_ptr<ProcessControlGroup>;
+
+/*!
+ * \brief Control group used for process accounting and termination.
+ *
+ * Implemented on top of cgroup v1 hierarchies (LegacyControlGroup)
+ * or cgroup v2 unified hierarchy (UnifiedControlGroup).
+ *
+ * Control groups created by createChild() are removed on destruction.
+ */
+class ProcessControlGroup : private boost::noncopyable {
+ public:
+  struct CpuUsage {
+    std::chrono::nanoseconds user{0};
+    std::chrono::nanoseconds system{0};
+    std::chrono::nanoseconds total{0};
+  };
+
+  /// Total stall time from pressure stall information.
+  struct Pressure {
+    std::chrono::microseconds some{0};
+    std::chrono::microseconds full{0};
+  };
+
+  struct CpuThrottling {
+    std::uint64_t periods = 0;
+    std::chrono::microseconds time{0};
+  };
+
+  /// Current memory usage by kind.
+  struct MemoryStat {
+    std::uint64_t anonymous = 0;
+    std::uint64_t pageCache = 0;
+
+    /// Shared memory and tmpfs files, part of page cache.
+    std::uint64_t shared = 0;
+    std::uint64_t kernel = 0;
+    std::uint64_t swap = 0;
+  };
+
+  struct IoUsage {
+    std::uint64_t readBytes = 0;
+    std::uint64_t writeBytes = 0;
+    std::uint64_t readOperations = 0;
+    std::uint64_t writeOperations = 0;
+  };
+
+  /// Per second, maximum value means unlimited.
+  struct IoLimits {
+    std::uint64_t readBytes = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t writeBytes = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t readOperations = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t writeOperations = std::numeric_limits<std::uint64_t>::max();
+  };
+
+ public:
+  /*!
+   * \brief Control group of current process.
+   *
+   * Unified hierarchy is used if it is mounted at /sys/fs/cgroup,
+   * cpuacct, cpuset, freezer and memory v1 hierarchies otherwise.
+   */
+  static ProcessControlGroupPointer forSelf();
+
+  virtual ~ProcessControlGroup();
+
+  /// Child inaccessible to other users.
+  virtual ProcessControlGroupPointer createChild(const std::string &name) = 0;
+
+  /// Prepare new control group for process accounting.
+  virtual void configure() = 0;
+
+  /*!
+   * \brief Reset accounting of empty control group.
+   *
+   * \return false if control group can't be reused,
+   * it is always so for cgroup v2.
+   */
+  virtual bool reset() = 0;
+
+  /// CPUs available to processes in cpuset(7) list format.
+  virtual std::string cpus() const = 0;
+
+  /*!
+   * \brief Pin processes to CPUs in cpuset(7) list format.
+   *
+   * CPUs should be available to parent control group.
+   */
+  virtual void setCpus(const std::string &cpus) = 0;
+
+  /// Memory nodes available to processes in cpuset(7) list format.
+  virtual std::string mems() const = 0;
+
+  /// No process is running in control group.
+  virtual bool empty() const = 0;
+
+  virtual void attachSelf() = 0;
+
+  /// Files process should write "0" to in order to attach itself.
+  virtual std::vector<boost::filesystem::path> attachFiles() const = 0;
+
+  /*!
+   * \brief Directory suitable for clone3(CLONE_INTO_CGROUP).
+   *
+   * \return empty path if not supported.
+   */
+  virtual boost::filesystem::path cloneIntoPath() const = 0;
+
+  /*!
+   * \brief Directory suitable for perf_event_open(PERF_FLAG_PID_CGROUP).
+   *
+   * \return empty path if not supported.
+   */
+  virtual boost::filesystem::path perfEventPath() const = 0;
+
+  /*!
+   * \brief Kill every process and wait until control group is empty.
+   *
+   * Processes are not able to escape by forking:
+   * the whole group is killed atomically.
+   * Waits at most terminationTimeout for processes to exit.
+   */
+  virtual void terminate() = 0;
+
+  virtual CpuUsage cpuUsage() const = 0;
+
+  /*!
+   * \param resource "cpu", "memory" or "io".
+   *
+   * \return boost::none if not supported.
+   */
+  virtual boost::optional<Pressure> pressure(
+      const std::string &resource) const = 0;
+
+  /// \return boost::none if not supported.
+  virtual boost::optional<CpuThrottling> cpuThrottling() const = 0;
+
+  /// \return boost::none if not supported.
+  virtual boost::optional<IoUsage> ioUsage() const = 0;
+
+  /*!
+   * \brief Throttle block I/O of each disk.
+   *
+   * \throws Error if not supported.
+   */
+  virtual void setIoLimits(const IoLimits &ioLimits) = 0;
+
+  virtual MemoryStat memoryStat() const = 0;
+
+  /*!
+   * \brief Maximum memory usage including page cache.
+   *
+   * \return boost::none if kernel does not maintain it
+   * (cgroup v2 before Linux 5.19).
+   */
+  virtual boost::optional<std::uint64_t> peakMemoryUsage() const = 0;
+
+  /*!
+   * \brief Maximum memory plus swap usage.
+   *
+   * \return boost::none if swap is not accounted.
+   */
+  virtual boost::optional<std::uint64_t> peakMemorySwapUsage() const = 0;
+
+  /*!
+   * \brief Set hard memory limit enforced by kernel.
+   *
+   * Exceeding it triggers oom-killer inside control group.
+   */
+  virtual void setMemoryLimit(std::uint64_t memoryLimitBytes) = 0;
+
+  /*!
+   * \brief Number of processes killed by oom-killer
+   * since configure() or reset().
+   *
+   * \return boost::none if kernel does not count them (before Linux 4.13),
+   * see memoryLimitHits().
+   */
+  virtual boost::optional<std::uint64_t> oomKills() const = 0;
+
+  /// How many times usage has hit the hard limit since configure() or reset().
+  virtual std::uint64_t memoryLimitHits() const = 0;
+
+  /*!
+   * \brief Notifies when memory usage should be sampled
+   * or oom-killer was invoked.
+   */
+  virtual std::unique_ptr<MemoryUsageWatcher> watchMemoryUsage(
+      std::uint64_t memoryLimitBytes) = 0;
+
+  /// Stop every process in control group until unfreeze().
+  virtual void freeze() = 0;
+  virtual void unfreeze() = 0;
+
+  /// Write raw control file, e.g. "memory.limit_in_bytes".
+  virtual void writeField(const std::string &field,
+                          const std::string &value) = 0;
+
+  virtual void print(std::ostream &out) const = 0;
+
+ protected:
+  /// How long killed processes are allowed to exit.
+  static const std::chrono::milliseconds terminationTimeout;
+};
+
+std::ostream &operator<<(std::ostream &out,
+                         const ProcessControlGroup &controlGroup);
+
+}  // namespace async_process_group_detail
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
@@ -1,6 +1,7 @@
 #include "ProcessGroupStarter.hpp"
 
-#include <yandex/contest/system/cgroup/MultipleControlGroup.hpp>
+#include "ControlGroupPool.hpp"
+
 #include <yandex/contest/system/unistd/Operations.hpp>
 
 #include <yandex/contest/StreamLog.hpp>
@@ -8,16 +9,14 @@
 
 #include <boost/assert.hpp>
 #include <boost/bind.hpp>
-#include <boost/format.hpp>
 #include <boost/make_shared.hpp>
 
+#include <algorithm>
+#include <exception>
 #include <functional>
-#include <set>
+#include <limits>
 
 #include <signal.h>
-#include <sys/time.h>
-#include <sys/wait.h>
-#include <unistd.h>
 
 namespace yandex {
 namespace contest {
@@ -27,29 +26,89 @@ namespace execution {
 namespace async_process_group_detail {
 
 namespace {
-void nop(int) {}
-}  // namespace
+/// Start barrier should not clash with descriptors required by children.
+int minStartBarrierFd(const AsyncProcessGroup::Task &task) {
+  int minFd = 3;
+  for (const AsyncProcessGroup::Process &process : task.processes)
+    for (const auto &fdStream : process.descriptors)
+      minFd = std::max(minFd, fdStream.first + 1);
+  return minFd;
+}
 
-const ProcessGroupStarter::Duration ProcessGroupStarter::waitInterval =
-    std::chrono::duration_cast<ProcessGroupStarter::Duration>(
-        std::chrono::milliseconds(100));
+/// \return nullptr if hardware events should not be counted.
+std::unique_ptr<PerfCounters> openPerfCounters(
+    const ProcessControlGroup &controlGroup,
+    const process::ResourceLimits &resourceLimits) {
+  const bool instructionLimit = resourceLimits.instructionLimit !=
+                                std::numeric_limits<std::uint64_t>::max();
+  if (!resourceLimits.countHardwareEvents && !instructionLimit) return nullptr;
+  const boost::filesystem::path path = controlGroup.perfEventPath();
+  std::unique_ptr<PerfCounters> perfCounters;
+  if (!path.empty())
+    perfCounters.reset(new PerfCounters(path, controlGroup.cpus()));
+  if (instructionLimit && !(perfCounters && perfCounters->countsInstructions()))
+    BOOST_THROW_EXCEPTION(Error() << Error::message(
+                              "Instruction limit is not supported."));
+  return perfCounters;
+}
 
-system::cgroup::ControlGroupPointer ProcessGroupStarter::getThisCgroup() {
-  const char *const subsystems[] = {"cpuacct", "cpuset", "freezer", "memory"};
-  const auto sys = system::cgroup::SystemInfo::instance();
-  std::set<std::size_t> hierarchies;
-  for (const char *const subsystem : subsystems)
-    hierarchies.insert(sys->bySubsystem(subsystem).id);
-  return system::cgroup::MultipleControlGroup::forSelf(hierarchies.begin(),
-                                                       hierarchies.end());
+/// Control group is not touched if I/O is unlimited.
+void setIoLimits(ProcessControlGroup &controlGroup,
+                 const process::ResourceLimits &resourceLimits) {
+  ProcessControlGroup::IoLimits ioLimits;
+  ioLimits.readBytes = resourceLimits.ioReadBytesPerSecond;
+  ioLimits.writeBytes = resourceLimits.ioWriteBytesPerSecond;
+  ioLimits.readOperations = resourceLimits.ioReadOperationsPerSecond;
+  ioLimits.writeOperations = resourceLimits.ioWriteOperationsPerSecond;
+  const std::uint64_t unlimited = std::numeric_limits<std::uint64_t>::max();
+  if (ioLimits.readBytes == unlimited && ioLimits.writeBytes == unlimited &&
+      ioLimits.readOperations == unlimited &&
+      ioLimits.writeOperations == unlimited)
+    return;
+  controlGroup.setIoLimits(ioLimits);
 }
 
+/*!
+ * \brief Call func(id) for each id in separate threads.
+ *
+ * \param whileRunning is called by current thread before join.
+ *
+ * \throws first exception thrown by func or whileRunning.
+ */
+void forEachInParallel(const std::size_t size,
+                       const std::function<void(Id)> &func,
+                       const std::function<void()> &whileRunning) {
+  std::vector<std::exception_ptr> errors(size + 1);
+  boost::thread_group threads;
+  for (Id id = 0; id < size; ++id) {
+    threads.create_thread([&func, &errors, id] {
+      try {
+        func(id);
+      } catch (...) {
+        errors[id] = std::current_exception();
+      }
+    });
+  }
+  try {
+    whileRunning();
+  } catch (...) {
+    errors[size] = std::current_exception();
+  }
+  threads.join_all();
+  for (const std::exception_ptr &error : errors)
+    if (error) std::rethrow_exception(error);
+}
+}  // namespace
+
 ProcessGroupStarter::ProcessGroupStarter(const AsyncProcessGroup::Task &task)
-    : work_(ioService_),
-      thisCgroup_(getThisCgroup()),
+    : eventLoop_(boost::bind(&ProcessGroupStarter::childTerminated, this, _1,
+                             _2)),
+      work_(ioService_),
+      thisCgroup_(ProcessControlGroup::forSelf()),
       id2processInfo_(task.processes.size()),
+      id2memoryUsageWatcher_(task.processes.size()),
       notifiers_(task.notifiers.size()),
-      monitor_(task.processes) {
+      monitor_(task.processes, task.resourceLimits) {
   workers_.create_thread(
       boost::bind(&boost::asio::io_service::run, &ioService_));
 
@@ -84,21 +143,74 @@ ProcessGroupStarter::ProcessGroupStarter(const AsyncProcessGroup::Task &task)
 
   // processes setup
   // TODO restrict memory usage of process group (excluding control process)
-  for (std::size_t id = 0; id < task.processes.size(); ++id) {
+  const std::size_t size = task.processes.size();
+  std::vector<ProcessControlGroupPointer> cgroups(size);
+  std::vector<std::unique_ptr<ProcessStarter>> starters(size);
+  std::vector<Pid> pids(size);
+  std::unique_ptr<StartBarrier> startBarrier;
+  if (task.parallelStart && size > 1)
+    startBarrier.reset(new StartBarrier(minStartBarrierFd(task)));
+  const auto prepare = [&](const Id id) {
     BOOST_ASSERT(task.processes[id].meta.id == id);
-    const std::string cid = str(boost::format("id_%1%") % id);
-    // we don't children to have access to cgroups
-    system::cgroup::ControlGroupPointer cg =
-        thisCgroup_->createChild(cid, 0700);
-    id2processInfo_[id].setControlGroup(cg);
-    ProcessStarter starter(cg, task.processes[id], pipes_);
-    const Pid pid = starter();
+    cgroups[id] = ControlGroupPool::instance().acquire(thisCgroup_);
+    id2processInfo_[id].setControlGroup(cgroups[id]);
+    // before anything depending on CPUs of control group
+    if (!task.cpus.empty()) cgroups[id]->setCpus(task.cpus);
+    cgroups[id]->setMemoryLimit(
+        task.processes[id].resourceLimits.memoryLimitBytes);
+    // usage growth is not notified before registration
+    id2memoryUsageWatcher_[id] = cgroups[id]->watchMemoryUsage(
+        task.processes[id].resourceLimits.memoryLimitBytes);
+    setIoLimits(*cgroups[id], task.processes[id].resourceLimits);
+    id2processInfo_[id].setPerfCounters(
+        openPerfCounters(*cgroups[id], task.processes[id].resourceLimits));
+    starters[id].reset(new ProcessStarter(cgroups[id], task.processes[id],
+                                          pipes_, startBarrier.get()));
+  };
+  if (startBarrier) {
+    STREAM_DEBUG << "Starting " << size << " processes in parallel...";
+    forEachInParallel(size, prepare, [] {});
+    // each spawning thread may be suspended until its child execs
+    forEachInParallel(
+        size,
+        [&](const Id id) {
+          try {
+            pids[id] = (*starters[id])();
+          } catch (...) {
+            StartBarrier::leave(startBarrier->readyFd());
+            throw;
+          }
+        },
+        [&] { startBarrier->release(size); });
+  } else {
+    for (Id id = 0; id < size; ++id) {
+      prepare(id);
+      pids[id] = (*starters[id])();
+    }
+  }
+  for (Id id = 0; id < size; ++id) {
+    const Pid pid = pids[id];
     id2processInfo_[id].setMeta(task.processes[id].meta);
     id2processInfo_[id].setPid(pid);
+    id2processInfo_[id].setCpuNumber(starters[id]->cpuNumber());
+    const process::ResourceLimits::MemoryCharge memoryCharge =
+        task.processes[id].resourceLimits.memoryCharge;
+    id2processInfo_[id].setMemoryCharge(memoryCharge);
+    // cgroup v2 only reports hitting the limit, anonymous memory
+    // and usage without memory.peak are not tracked by kernel
+    id2processInfo_[id].setMemoryUsageIsPolled(
+        !id2memoryUsageWatcher_[id]->notifiesThresholds() &&
+        (memoryCharge == process::ResourceLimits::MemoryCharge::RESIDENT ||
+         !cgroups[id]->peakMemoryUsage()));
     BOOST_ASSERT(pid2id_.find(pid) == pid2id_.end());
     pid2id_[pid] = id;
     monitor_.started(id2processInfo_[id], task.processes[id]);
+    eventLoop_.addDescriptor(
+        id2memoryUsageWatcher_[id]->fd(),
+        boost::bind(&ProcessGroupStarter::memoryUsageChanged, this, id),
+        id2memoryUsageWatcher_[id]->events());
   }
+  starters.clear();
 
   pipes_.clear();
   BOOST_ASSERT(monitor_.running().size() == task.processes.size());
@@ -107,16 +219,10 @@ ProcessGroupStarter::ProcessGroupStarter(const AsyncProcessGroup::Task &task)
   {
     struct sigaction act;
 
-    // SIGALRM
-    act.sa_handler = nop;
-    act.sa_flags = 0;
-    sigemptyset(&act.sa_mask);
-    if (sigaction(SIGALRM, &act, nullptr) < 0)
-      BOOST_THROW_EXCEPTION(SystemError("sigaction"));
-
     // SIGPIPE
     act.sa_handler = SIG_IGN;
     act.sa_flags = 0;
+    sigemptyset(&act.sa_mask);
     if (sigaction(SIGPIPE, &act, nullptr) < 0)
       BOOST_THROW_EXCEPTION(SystemError("sigaction"));
   }
@@ -133,18 +239,20 @@ ProcessGroupStarter::~ProcessGroupStarter() {
 void ProcessGroupStarter::executionLoop() {
   STREAM_DEBUG << "Starting execution loop...";
 
-  workers_.create_thread(
-      boost::bind(&ProcessGroupStarter::memoryUsageLoader, this));
-
   STREAM_TRACE << "Waiting loop...";
   while (monitor_.processGroupIsRunning()) {
+    TimePoint checkPoint = realTimeLimitPoint_;
     for (const Id id : monitor_.running()) {
-      if (monitor_.runOutOfResourceLimits(id2processInfo_[id])) {
+      ProcessInfo &processInfo = id2processInfo_[id];
+      if (monitor_.runOutOfResourceLimits(processInfo)) {
         terminate(id);
-        monitor_.terminatedBySystem(id2processInfo_[id]);
+        monitor_.terminatedBySystem(processInfo);
+      } else {
+        checkPoint =
+            std::min(checkPoint, monitor_.timeLimitsCheckPoint(processInfo));
       }
     }
-    waitForAnyChild(std::bind(waitFor, std::placeholders::_1, waitInterval));
+    eventLoop_.runUntil(checkPoint);
     if (Clock::now() >= realTimeLimitPoint_) monitor_.realTimeLimitExceeded();
   }
 
@@ -158,9 +266,7 @@ void ProcessGroupStarter::executionLoop() {
 
   // collect results
   STREAM_TRACE << "Collection results...";
-  while (monitor_.processesAreRunning()) {
-    waitForAnyChild(wait);
-  }
+  while (monitor_.processesAreRunning()) eventLoop_.run();
   // end of function
 
   monitor_.allTerminated();
@@ -176,11 +282,11 @@ void ProcessGroupStarter::executionLoop() {
   for (ProcessInfo &processInfo : id2processInfo_) {
     BOOST_ASSERT_MSG(processInfo.terminated(),
                      "Every process should be terminated.");
-    if (!processInfo.controlGroup().tasks().empty()) {
+    if (!processInfo.controlGroup().empty()) {
       STREAM_ERROR << processInfo.controlGroup() << " is not empty!";
       processInfo.terminate();
     }
-    processInfo.unsetControlGroup();
+    ControlGroupPool::instance().release(processInfo.unsetControlGroup());
   }
   STREAM_TRACE << "Execution loop has completed.";
 }
@@ -191,144 +297,28 @@ void ProcessGroupStarter::terminate(const Id id) {
   id2processInfo_[id].terminate();
 }
 
-void ProcessGroupStarter::waitForAnyChild(const WaitFunction &waitFunction) {
-  STREAM_TRACE << "Waiting for a child...";
-  BOOST_ASSERT(monitor_.processesAreRunning());
-  int statLoc;
-  const Pid pid = waitFunction(statLoc);
-  STREAM_TRACE << "waitFunction has returned pid = " << pid << ".";
-  if (pid != 0) {
-    BOOST_ASSERT(pid > 0);
-    BOOST_ASSERT_MSG(pid2id_.find(pid) != pid2id_.end(),
-                     "We received process we haven't started.");
-    const Id id = pid2id_.at(pid);
-    terminate(id);
-    monitor_.terminated(id2processInfo_[id], statLoc);
-  }
-}
-
-Pid ProcessGroupStarter::wait(int &statLoc) {
-  STREAM_TRACE << "Waiting for a child [timeout=infinity]...";
-  Pid rpid;
-  do {
-    rpid = ::wait(&statLoc);
-  } while (rpid < 0 && errno == EINTR);
-  BOOST_ASSERT_MSG(rpid != 0, "Timeout is not possible.");
-  if (rpid < 0) {
-    BOOST_ASSERT_MSG(errno != ECHILD, "We have child processes.");
-    BOOST_THROW_EXCEPTION(SystemError(errno, "wait")
-                          << Error::message("Undocumented error."));
-  }
-  return rpid;
+void ProcessGroupStarter::childTerminated(const Pid pid, const int statLoc) {
+  BOOST_ASSERT(pid > 0);
+  BOOST_ASSERT_MSG(pid2id_.find(pid) != pid2id_.end(),
+                   "We received process we haven't started.");
+  const Id id = pid2id_.at(pid);
+  eventLoop_.removeDescriptor(id2memoryUsageWatcher_[id]->fd());
+  terminate(id);
+  monitor_.terminated(id2processInfo_[id], statLoc);
+  id2memoryUsageWatcher_[id].reset();
 }
 
-namespace {
-template <typename Duration>
-::timeval toTimeval(const Duration &duration) {
-  constexpr unsigned MAXVAL = 1000 * 1000;
-  ::timeval tval;
-  tval.tv_sec =
-      std::chrono::duration_cast<std::chrono::seconds>(duration).count();
-  tval.tv_usec =
-      std::chrono::duration_cast<std::chrono::microseconds>(duration).count() %
-      MAXVAL;
-  BOOST_ASSERT(0 <= tval.tv_sec && tval.tv_sec < MAXVAL);
-  BOOST_ASSERT(0 <= tval.tv_usec && tval.tv_usec < MAXVAL);
-  return tval;
-}  // namespace
-
-/// Used to interrupt system calls.
-class IntervalTimer : private boost::noncopyable {
- public:
-  template <typename Duration>
-  explicit IntervalTimer(const Duration &duration) {
-    tval_.it_interval = zeroTimeVal;
-    // too small values are dangerous
-    tval_.it_value =
-        duration < resolution ? toTimeval(resolution) : toTimeval(duration);
-    tval_.it_interval = toTimeval(resolution);  // in case event is missed
-    BUNSAN_LOG_TRACE << "Setting timer for " << tval_.it_value.tv_sec << "s + "
-                     << tval_.it_value.tv_usec << "us";
-    system::unistd::setitimer(ITIMER_REAL, tval_);
-  }
-
-  void disable() noexcept {
-    if (*this) {
-      // this function may not throw with zero argument
-      system::unistd::setitimer(ITIMER_REAL, zeroITimerVal);
-      tval_.it_value = zeroTimeVal;
-    }
-  }
-
-  explicit operator bool() const noexcept {
-    return tval_.it_value.tv_sec || tval_.it_value.tv_usec;
-  }
-
-  ~IntervalTimer() { disable(); }
-
- private:
-  static const ::timeval zeroTimeVal;
-  static const ::itimerval zeroITimerVal;
-  static const std::chrono::milliseconds resolution;
-
- private:
-  ::itimerval tval_;
-};
-
-const ::timeval IntervalTimer::zeroTimeVal = {.tv_sec = 0, .tv_usec = 0};
-
-const ::itimerval IntervalTimer::zeroITimerVal = {
-    .it_interval = {.tv_sec = 0, .tv_usec = 0},
-    .it_value = {.tv_sec = 0, .tv_usec = 0}};
-
-const std::chrono::milliseconds IntervalTimer::resolution(10);
-}  // namespace
-
-Pid ProcessGroupStarter::waitFor(int &statLoc, const Duration &duration) {
-  STREAM_TRACE << "Waiting for a child [timeout=" << duration.count() << "]...";
-  return waitUntil(statLoc, Clock::now() + duration);
-}
-
-Pid ProcessGroupStarter::waitUntil(int &statLoc, const TimePoint &untilPoint) {
-  STREAM_TRACE << "Waiting for a child [until="
-               << untilPoint.time_since_epoch().count() << "]...";
-  TimePoint now = Clock::now();
-  if (now >= untilPoint) return 0;
-  Pid rpid;
-  int errno_ = 0;
-  do {
-    {
-      IntervalTimer timer(untilPoint - now);
-      // will be interrupted on timer event
-      rpid = ::wait(&statLoc);
-      errno_ = errno;
-    }
-    // first assignment and check was made at the beginning of the function
-    now = Clock::now();
-    if (now >= untilPoint) return rpid > 0 ? rpid : 0;
-  } while (rpid < 0 && errno_ == EINTR);
-  BOOST_ASSERT_MSG(rpid != 0, "Timeout is not possible.");
-  if (rpid < 0) {
-    BOOST_ASSERT_MSG(errno_ != ECHILD, "We have child processes.");
-    BOOST_THROW_EXCEPTION(SystemError(errno_, "wait")
-                          << Error::message("Undocumented error."));
+void ProcessGroupStarter::memoryUsageChanged(const Id id) {
+  BOOST_ASSERT(id < id2processInfo_.size());
+  BOOST_ASSERT(id2memoryUsageWatcher_[id]);
+  id2memoryUsageWatcher_[id]->acknowledge();
+  ProcessInfo &processInfo = id2processInfo_[id];
+  if (processInfo.terminated()) return;
+  processInfo.updateMaxMemoryUsageFromMemoryStat();
+  if (monitor_.runOutOfResourceLimits(processInfo)) {
+    terminate(id);
+    monitor_.terminatedBySystem(processInfo);
   }
-  return rpid;
-}
-
-void ProcessGroupStarter::memoryUsageLoader() {
-  bool found;
-  do {
-    found = false;
-    for (ProcessInfo &processInfo : id2processInfo_) {
-      if (!processInfo.terminated()) {
-        found = true;
-        processInfo.updateMaxMemoryUsageFromMemoryStat();
-      }
-    }
-    // FIXME hardcode
-    boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
-  } while (found);
 }
 
 }  // namespace async_process_group_detail
@@ -1,11 +1,14 @@
 #pragma once
 
+#include "EventLoop.hpp"
 #include "ExecutionMonitor.hpp"
+#include "MemoryUsageWatcher.hpp"
 #include "Notifier.hpp"
+#include "ProcessControlGroup.hpp"
 #include "ProcessInfo.hpp"
 #include "ProcessStarter.hpp"
+#include "StartBarrier.hpp"
 
-#include <yandex/contest/system/cgroup/ControlGroup.hpp>
 #include <yandex/contest/system/unistd/Pipe.hpp>
 
 #include <boost/noncopyable.hpp>
@@ -13,7 +16,6 @@
 #include <boost/thread.hpp>
 
 #include <chrono>
-#include <functional>
 #include <memory>
 #include <vector>
 
@@ -26,17 +28,10 @@ namespace async_process_group_detail {
 
 class ProcessGroupStarter : private boost::noncopyable {
  public:
-  using Clock = std::chrono::steady_clock;
+  using Clock = EventLoop::Clock;
   using TimePoint = Clock::time_point;
   using Duration = Clock::duration;
 
-  /*!
-   * \brief Wait for child.
-   *
-   * \return negative on fail, zero on skip, positive on success
-   */
-  using WaitFunction = std::function<Pid(int &)>;
-
  public:
   explicit ProcessGroupStarter(const AsyncProcessGroup::Task &task);
 
@@ -49,39 +44,25 @@ class ProcessGroupStarter : private boost::noncopyable {
  private:
   void terminate(const Id id);
 
-  void waitForAnyChild(const WaitFunction &waitFunction);
-
-  /// wait3 analogue except it handles interruptions
-  static Pid wait(int &statLoc);
-
-  /// Return 0 if no process has terminated during duration time
-  static Pid waitFor(int &statLoc, const Duration &duration);
+  /// Called by EventLoop for every waited child.
+  void childTerminated(Pid pid, int statLoc);
 
-  /*!
-   * \brief wait3 analogue except it handles interruptions.
-   *
-   * \return 0 if until was reached
-   *
-   * \warning Function may return pid even if untilPoint was reached.
-   */
-  static Pid waitUntil(int &statLoc, const TimePoint &untilPoint);
-
-  void memoryUsageLoader();
+  /// Called by EventLoop when memory usage crosses threshold.
+  void memoryUsageChanged(Id id);
 
  private:
-  static const Duration waitInterval;
-
-  static system::cgroup::ControlGroupPointer getThisCgroup();
+  // should be constructed before any thread or child is started
+  EventLoop eventLoop_;
 
- private:
   boost::asio::io_service ioService_;
   boost::asio::io_service::work work_;
 
   boost::thread_group workers_;
 
-  system::cgroup::ControlGroupPointer thisCgroup_;
+  ProcessControlGroupPointer thisCgroup_;
   std::vector<ProcessInfo> id2processInfo_;
   std::unordered_map<Pid, Id> pid2id_;
+  std::vector<std::unique_ptr<MemoryUsageWatcher>> id2memoryUsageWatcher_;
 
   std::vector<boost::shared_ptr<Notifier>> notifiers_;
 
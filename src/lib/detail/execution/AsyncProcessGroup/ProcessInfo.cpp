@@ -1,15 +1,13 @@
 #include "ProcessInfo.hpp"
 
-#include <yandex/contest/system/cgroup/CpuAccounting.hpp>
-#include <yandex/contest/system/cgroup/Memory.hpp>
-#include <yandex/contest/system/cgroup/MemorySwap.hpp>
-#include <yandex/contest/system/cgroup/Termination.hpp>
-
 #include <yandex/contest/StreamLog.hpp>
 #include <yandex/contest/SystemError.hpp>
 
 #include <boost/assert.hpp>
 
+#include <algorithm>
+#include <utility>
+
 #include <signal.h>
 
 namespace yandex {
@@ -19,6 +17,16 @@ namespace detail {
 namespace execution {
 namespace async_process_group_detail {
 
+ProcessInfo::~ProcessInfo() {
+  if (!controlGroup_) return;
+  try {
+    controlGroup_->terminate();
+  } catch (std::exception &e) {
+    STREAM_ERROR << "Unable to terminate " << *controlGroup_ << " due to \""
+                 << e.what() << "\" (ignoring).";
+  }
+}
+
 const ProcessMeta &ProcessInfo::meta() const { return meta_; }
 
 void ProcessInfo::setMeta(const ProcessMeta &meta) { meta_ = meta; }
@@ -35,25 +43,36 @@ Pid ProcessInfo::pid() const { return pid_; }
 
 void ProcessInfo::setPid(const Pid pid) { pid_ = pid; }
 
-const system::cgroup::ControlGroup &ProcessInfo::controlGroup() const {
+const ProcessControlGroup &ProcessInfo::controlGroup() const {
   BOOST_ASSERT(controlGroup_);
   return *controlGroup_;
 }
 
-system::cgroup::ControlGroup &ProcessInfo::controlGroup() {
+ProcessControlGroup &ProcessInfo::controlGroup() {
   BOOST_ASSERT(controlGroup_);
   return *controlGroup_;
 }
 
 void ProcessInfo::setControlGroup(
-    const system::cgroup::ControlGroupPointer &controlGroup) {
+    const ProcessControlGroupPointer &controlGroup) {
   controlGroup_ = controlGroup;
-  terminationGuard_ = system::cgroup::TerminationGuard(controlGroup_);
 }
 
-void ProcessInfo::unsetControlGroup() {
-  controlGroup_.reset();
-  terminationGuard_ = system::cgroup::TerminationGuard();
+ProcessControlGroupPointer ProcessInfo::unsetControlGroup() {
+  ProcessControlGroupPointer controlGroup;
+  controlGroup.swap(controlGroup_);
+  return controlGroup;
+}
+
+void ProcessInfo::setPerfCounters(std::unique_ptr<PerfCounters> perfCounters) {
+  perfCounters_ = std::move(perfCounters);
+}
+
+std::size_t ProcessInfo::cpuNumber() const { return cpuNumber_; }
+
+void ProcessInfo::setCpuNumber(const std::size_t cpuNumber) {
+  BOOST_ASSERT(cpuNumber > 0);
+  cpuNumber_ = cpuNumber;
 }
 
 void ProcessInfo::terminate() {
@@ -64,15 +83,19 @@ void ProcessInfo::terminate() {
     BOOST_THROW_EXCEPTION(SystemError("kill")
                           << Error::message("This should not happen."));
   // \todo Do we need to check for lost children and report?
-  system::cgroup::terminate(controlGroup_);
+  controlGroup_->terminate();
   terminated_.store(true);
 
-  // collect memory usage info
-  const system::cgroup::Memory memory(controlGroup_);
-  // this happens if memory usage has never been taken from stat()
-  // while process was alive, in that case maxUsage() is pretty accurate
-  // TODO take memsw.maxUsage() into account
-  setMaxMemoryUsageBytesIfZero(memory.maxUsage());
+  // collect memory usage info,
+  // current usage is meaningless after exit, only kernel peaks are used
+  if (memoryCharge_ == process::ResourceLimits::MemoryCharge::RESIDENT) {
+    // this happens if memory usage has never been taken from stat()
+    // while process was alive, in that case peak usage is pretty accurate
+    if (const auto peak = controlGroup_->peakMemoryUsage())
+      setMaxMemoryUsageBytesIfZero(*peak);
+  } else if (const auto peak = peakChargedMemoryUsage()) {
+    updateMaxMemoryUsageBytes(*peak);
+  }
 }
 
 bool ProcessInfo::terminated() const { return terminated_.load(); }
@@ -81,19 +104,74 @@ void ProcessInfo::fillResourceUsage(
     process::ResourceUsage &resourceUsage) const {
   resourceUsage.memoryUsageBytes = maxMemoryUsageBytes();
   fillTimeUsage(resourceUsage);
+  if (perfCounters_) perfCounters_->fillResourceUsage(resourceUsage);
+}
+
+std::uint64_t ProcessInfo::oomKills(const bool killed) const {
+  if (const auto oomKills = controlGroup_->oomKills()) return *oomKills;
+  return killed && controlGroup_->memoryLimitHits() ? 1 : 0;
 }
 
 void ProcessInfo::fillTimeUsage(process::ResourceUsage &resourceUsage) const {
-  const system::cgroup::CpuAccounting cpuAcct(controlGroup_);
-  const auto cpuAcctStat = cpuAcct.stat();
+  const ProcessControlGroup::CpuUsage cpuUsage = controlGroup_->cpuUsage();
   resourceUsage.userTimeUsage =
-      std::chrono::duration_cast<std::chrono::milliseconds>(
-          cpuAcctStat.userUsage);
+      std::chrono::duration_cast<std::chrono::milliseconds>(cpuUsage.user);
   resourceUsage.systemTimeUsage =
-      std::chrono::duration_cast<std::chrono::milliseconds>(
-          cpuAcctStat.systemUsage);
+      std::chrono::duration_cast<std::chrono::milliseconds>(cpuUsage.system);
   resourceUsage.timeUsage =
-      std::chrono::duration_cast<std::chrono::nanoseconds>(cpuAcct.usage());
+      std::chrono::duration_cast<std::chrono::nanoseconds>(cpuUsage.total);
+}
+
+void ProcessInfo::fillContentionUsage(
+    process::ResourceUsage &resourceUsage) const {
+  if (const auto cpu = controlGroup_->pressure("cpu"))
+    resourceUsage.cpuSomeStallTime = cpu->some;
+  if (const auto memory = controlGroup_->pressure("memory")) {
+    resourceUsage.memorySomeStallTime = memory->some;
+    resourceUsage.memoryFullStallTime = memory->full;
+  }
+  if (const auto io = controlGroup_->pressure("io")) {
+    resourceUsage.ioSomeStallTime = io->some;
+    resourceUsage.ioFullStallTime = io->full;
+  }
+  if (const auto throttling = controlGroup_->cpuThrottling()) {
+    resourceUsage.throttledPeriods = throttling->periods;
+    resourceUsage.throttledTime = throttling->time;
+  }
+}
+
+void ProcessInfo::fillIoUsage(process::ResourceUsage &resourceUsage) const {
+  if (const auto io = controlGroup_->ioUsage()) {
+    resourceUsage.ioReadBytes = io->readBytes;
+    resourceUsage.ioWriteBytes = io->writeBytes;
+    resourceUsage.ioReadOperations = io->readOperations;
+    resourceUsage.ioWriteOperations = io->writeOperations;
+  }
+}
+
+void ProcessInfo::setMemoryCharge(
+    const process::ResourceLimits::MemoryCharge memoryCharge) {
+  memoryCharge_ = memoryCharge;
+}
+
+bool ProcessInfo::memoryUsageIsPolled() const { return memoryUsageIsPolled_; }
+
+void ProcessInfo::setMemoryUsageIsPolled(const bool memoryUsageIsPolled) {
+  memoryUsageIsPolled_ = memoryUsageIsPolled;
+}
+
+void ProcessInfo::fillMemoryUsage(
+    process::ResourceUsage &resourceUsage) const {
+  {
+    const std::lock_guard<std::mutex> lock(maxMemoryStatLock_);
+    resourceUsage.anonymousMemoryBytes = maxMemoryStat_.anonymous;
+    resourceUsage.pageCacheBytes = maxMemoryStat_.pageCache;
+    resourceUsage.sharedMemoryBytes = maxMemoryStat_.shared;
+    resourceUsage.kernelMemoryBytes = maxMemoryStat_.kernel;
+    resourceUsage.swapBytes = maxMemoryStat_.swap;
+  }
+  resourceUsage.peakMemoryBytes = controlGroup_->peakMemoryUsage();
+  resourceUsage.peakMemorySwapBytes = controlGroup_->peakMemorySwapUsage();
 }
 
 std::uint64_t ProcessInfo::maxMemoryUsageBytes() const {
@@ -101,10 +179,50 @@ std::uint64_t ProcessInfo::maxMemoryUsageBytes() const {
 }
 
 void ProcessInfo::updateMaxMemoryUsageFromMemoryStat() {
-  const system::cgroup::Memory memory(controlGroup_);
-  const system::cgroup::MemorySwap memsw(controlGroup_);
-  // TODO take swap into account
-  updateMaxMemoryUsageBytes(memory.stat().at("rss"));
+  const ProcessControlGroup::MemoryStat memoryStat =
+      controlGroup_->memoryStat();
+  std::uint64_t maxNonResident;
+  {
+    const std::lock_guard<std::mutex> lock(maxMemoryStatLock_);
+    ProcessControlGroup::MemoryStat &max = maxMemoryStat_;
+    max.anonymous = std::max(max.anonymous, memoryStat.anonymous);
+    max.pageCache = std::max(max.pageCache, memoryStat.pageCache);
+    max.shared = std::max(max.shared, memoryStat.shared);
+    max.kernel = std::max(max.kernel, memoryStat.kernel);
+    max.swap = std::max(max.swap, memoryStat.swap);
+    maxNonResident = max.pageCache + max.kernel;
+  }
+  if (memoryCharge_ == process::ResourceLimits::MemoryCharge::RESIDENT) {
+    std::uint64_t resident = memoryStat.anonymous;
+    // spike may be gone before it is sampled, kernel peak
+    // without the largest page cache and kernel memory seen so far
+    // does not miss it and does not charge page cache
+    if (const auto peak = controlGroup_->peakMemoryUsage()) {
+      if (*peak > maxNonResident)
+        resident = std::max(resident, *peak - maxNonResident);
+    }
+    updateMaxMemoryUsageBytes(resident);
+  } else if (const auto peak = peakChargedMemoryUsage()) {
+    updateMaxMemoryUsageBytes(*peak);
+  } else {
+    // kernel does not maintain peak, sampled usage is the best estimate
+    const bool withSwap =
+        memoryCharge_ == process::ResourceLimits::MemoryCharge::PEAK_WITH_SWAP;
+    updateMaxMemoryUsageBytes(memoryStat.anonymous + memoryStat.pageCache +
+                              memoryStat.kernel +
+                              (withSwap ? memoryStat.swap : 0));
+  }
+}
+
+boost::optional<std::uint64_t> ProcessInfo::peakChargedMemoryUsage() const {
+  const boost::optional<std::uint64_t> peak = controlGroup_->peakMemoryUsage();
+  if (!peak ||
+      memoryCharge_ != process::ResourceLimits::MemoryCharge::PEAK_WITH_SWAP)
+    return peak;
+  if (const auto peakWithSwap = controlGroup_->peakMemorySwapUsage())
+    return peakWithSwap;
+  // swap peak is not available, current swap usage is the best estimate
+  return *peak + controlGroup_->memoryStat().swap;
 }
 
 void ProcessInfo::updateMaxMemoryUsageBytes(
@@ -1,11 +1,15 @@
 #pragma once
 
+#include "PerfCounters.hpp"
+#include "ProcessControlGroup.hpp"
+
 #include <yandex/contest/invoker/detail/CommonProcessTypedefs.hpp>
 
-#include <yandex/contest/system/cgroup/ControlGroup.hpp>
-#include <yandex/contest/system/cgroup/Termination.hpp>
+#include <boost/optional.hpp>
 
 #include <atomic>
+#include <memory>
+#include <mutex>
 
 #include <cstdint>
 
@@ -37,6 +41,9 @@ extern const int SIG_START_FAILED;
 
 class ProcessInfo {
  public:
+  ProcessInfo() = default;
+  ~ProcessInfo();
+
   const ProcessMeta &meta() const;
   void setMeta(const ProcessMeta &meta);
 
@@ -49,21 +56,67 @@ class ProcessInfo {
   Pid pid() const;
   void setPid(Pid pid);
 
-  const system::cgroup::ControlGroup &controlGroup() const;
-  system::cgroup::ControlGroup &controlGroup();
-  void setControlGroup(const system::cgroup::ControlGroupPointer &controlGroup);
-  void unsetControlGroup();
+  const ProcessControlGroup &controlGroup() const;
+  ProcessControlGroup &controlGroup();
+
+  /// Control group is terminated on destruction unless it is unset.
+  void setControlGroup(const ProcessControlGroupPointer &controlGroup);
+
+  /// \return Control group that was set.
+  ProcessControlGroupPointer unsetControlGroup();
+
+  /// Hardware events are reported if set.
+  void setPerfCounters(std::unique_ptr<PerfCounters> perfCounters);
+
+  /// Number of CPUs process is allowed to run on.
+  std::size_t cpuNumber() const;
+  void setCpuNumber(std::size_t cpuNumber);
 
   void terminate();
   bool terminated() const;
 
   void fillResourceUsage(process::ResourceUsage &resourceUsage) const;
+
+  /*!
+   * \brief Number of processes killed by oom-killer.
+   *
+   * \param killed process was killed by SIGKILL not sent by terminate(),
+   * if kernel does not count oom kills, such process is assumed
+   * to be killed by oom-killer after memory usage has hit the limit.
+   */
+  std::uint64_t oomKills(bool killed) const;
   void fillTimeUsage(process::ResourceUsage &resourceUsage) const;
 
+  /// Pressure stall and throttling statistics, cumulative.
+  void fillContentionUsage(process::ResourceUsage &resourceUsage) const;
+
+  /// Block I/O statistics, cumulative.
+  void fillIoUsage(process::ResourceUsage &resourceUsage) const;
+
+  void setMemoryCharge(process::ResourceLimits::MemoryCharge memoryCharge);
+
+  /*!
+   * \brief Memory usage is not reported by MemoryUsageWatcher
+   * and should be sampled periodically.
+   */
+  bool memoryUsageIsPolled() const;
+  void setMemoryUsageIsPolled(bool memoryUsageIsPolled);
+
+  /// Memory breakdown and kernel-maintained peaks.
+  void fillMemoryUsage(process::ResourceUsage &resourceUsage) const;
+
+  /// Charged memory, see process::ResourceLimits::memoryCharge.
   std::uint64_t maxMemoryUsageBytes() const;
   void updateMaxMemoryUsageFromMemoryStat();
 
  private:
+  /*!
+   * \brief For charge policies based on kernel-maintained peaks.
+   *
+   * \return boost::none if kernel does not maintain peak.
+   */
+  boost::optional<std::uint64_t> peakChargedMemoryUsage() const;
+
   void updateMaxMemoryUsageBytes(std::uint64_t memoryUsageBytes);
   bool setMaxMemoryUsageBytesIfZero(std::uint64_t memoryUsageBytes);
 
@@ -72,10 +125,16 @@ class ProcessInfo {
  private:
   ProcessMeta meta_;
   Pid pid_{0};
-  system::cgroup::ControlGroupPointer controlGroup_;
-  system::cgroup::TerminationGuard terminationGuard_;
+  std::size_t cpuNumber_{1};
+  ProcessControlGroupPointer controlGroup_;
+  std::unique_ptr<PerfCounters> perfCounters_;
   std::atomic<bool> terminated_{false};
   std::atomic<std::uint64_t> maxMemoryUsageBytes_{0};
+  process::ResourceLimits::MemoryCharge memoryCharge_ =
+      process::ResourceLimits::MemoryCharge::RESIDENT;
+  bool memoryUsageIsPolled_ = false;
+  mutable std::mutex maxMemoryStatLock_;
+  ProcessControlGroup::MemoryStat maxMemoryStat_;
 };
 
 std::ostream &operator<<(std::ostream &out, const ProcessInfo &info);
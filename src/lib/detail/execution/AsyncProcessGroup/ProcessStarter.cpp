@@ -2,9 +2,8 @@
 
 #include "Streams.hpp"
 
-#include <yandex/contest/system/cgroup/CpuSet.hpp>
-#include <yandex/contest/system/cgroup/Memory.hpp>
-#include <yandex/contest/system/cgroup/MemorySwap.hpp>
+#include <yandex/contest/invoker/detail/CpuList.hpp>
+
 #include <yandex/contest/system/unistd/access/Operations.hpp>
 #include <yandex/contest/system/unistd/Operations.hpp>
 
@@ -13,13 +12,40 @@
 
 #include <bunsan/log/fallback.hpp>
 
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
 #include <boost/assert.hpp>
-#include <boost/dynamic_bitset.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/numeric/conversion/cast.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <set>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 #include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef SYS_clone3
+#define SYS_clone3 435
+#endif
+
+#ifndef SYS_close_range
+#define SYS_close_range 436
+#endif
+
+#ifndef CLONE_INTO_CGROUP
+#define CLONE_INTO_CGROUP 0x200000000ULL
+#endif
 
 namespace yandex {
 namespace contest {
@@ -38,16 +64,172 @@ struct UnresolvedFdAliasError : virtual FdAliasError {};
 
 struct InvalidTargetFdAliasError : virtual FdAliasError {};
 
+namespace {
+/// struct clone_args from linux/sched.h, version 2.
+struct CloneArgs {
+  std::uint64_t flags;
+  std::uint64_t pidfd;
+  std::uint64_t child_tid;
+  std::uint64_t parent_tid;
+  std::uint64_t exit_signal;
+  std::uint64_t stack;
+  std::uint64_t stack_size;
+  std::uint64_t tls;
+  std::uint64_t set_tid;
+  std::uint64_t set_tid_size;
+  std::uint64_t cgroup;
+};
+
+/// Whether clone3(CLONE_INTO_CGROUP) has failed as unsupported.
+std::atomic<bool> cloneIntoCgroupUnsupported(false);
+
+/// Enough for vforkChild(), it does not call anything heavy.
+constexpr std::size_t VFORK_STACK_SIZE = 64 * 1024;
+
+/// Signal handlers of control process should not run on child's stack.
+class SignalBlocker : private boost::noncopyable {
+ public:
+  SignalBlocker() {
+    ::sigset_t all;
+    sigfillset(&all);
+    const int errno_ = ::pthread_sigmask(SIG_SETMASK, &all, &old_);
+    if (errno_) BOOST_THROW_EXCEPTION(SystemError(errno_, "pthread_sigmask"));
+  }
+
+  ~SignalBlocker() {
+    BOOST_VERIFY(::pthread_sigmask(SIG_SETMASK, &old_, nullptr) == 0);
+  }
+
+ private:
+  ::sigset_t old_;
+};
+
+#if defined(__x86_64__) || defined(__aarch64__)
+#define HAVE_RAW_CLONE3_VFORK
+/*!
+ * \brief clone3(2) running child routine on its own stack.
+ *
+ * glibc does not export clone3(2) wrapper,
+ * child can't return from syscall(2) on a new stack.
+ * Child calls routine and exits with its result.
+ *
+ * \return pid or -errno.
+ */
+long rawClone3(CloneArgs *const args, int (*const routine)(void *),
+               void *const arg) noexcept {
+#if defined(__x86_64__)
+  register long rax asm("rax") = SYS_clone3;
+  register CloneArgs *rdi asm("rdi") = args;
+  register std::size_t rsi asm("rsi") = sizeof(*args);
+  register int (*r12)(void *) asm("r12") = routine;
+  register void *r13 asm("r13") = arg;
+  asm volatile(
+      "syscall\n\t"
+      "test %%rax, %%rax\n\t"
+      "jnz 1f\n\t"
+      "xor %%ebp, %%ebp\n\t"
+      "mov %%r13, %%rdi\n\t"
+      "call *%%r12\n\t"
+      "mov %%eax, %%edi\n\t"
+      "mov %[exit], %%eax\n\t"
+      "syscall\n\t"
+      "hlt\n\t"
+      "1:\n\t"
+      : "+r"(rax)
+      : "r"(rdi), "r"(rsi), "r"(r12), "r"(r13), [exit] "i"(SYS_exit)
+      : "rcx", "r11", "memory");
+  return rax;
+#elif defined(__aarch64__)
+  register long x8 asm("x8") = SYS_clone3;
+  register long x0 asm("x0") = reinterpret_cast<long>(args);
+  register long x1 asm("x1") = sizeof(*args);
+  register int (*x2)(void *) asm("x2") = routine;
+  register void *x3 asm("x3") = arg;
+  asm volatile(
+      "svc #0\n\t"
+      "cbnz x0, 1f\n\t"
+      "mov x29, xzr\n\t"
+      "mov x0, x3\n\t"
+      "blr x2\n\t"
+      "mov x8, %[exit]\n\t"
+      "svc #0\n\t"
+      "1:\n\t"
+      : "+r"(x0)
+      : "r"(x8), "r"(x1), "r"(x2), "r"(x3), [exit] "i"(SYS_exit)
+      : "memory");
+  return x0;
+#endif
+}
+#endif
+
+/// Execute permission of regular file for the owner-to-be.
+bool executableBy(const std::string &path,
+                  const system::unistd::access::Id &ownerId) {
+  struct ::stat st;
+  if (::stat(path.c_str(), &st) < 0 || !S_ISREG(st.st_mode)) return false;
+  // child has no supplementary groups except gid
+  if (ownerId.uid == 0) return st.st_mode & (S_IXUSR | S_IXGRP | S_IXOTH);
+  if (ownerId.uid == st.st_uid) return st.st_mode & S_IXUSR;
+  if (ownerId.gid == st.st_gid) return st.st_mode & S_IXGRP;
+  return st.st_mode & S_IXOTH;
+}
+
+/*!
+ * \brief Resolve executable like execvp(3) does.
+ *
+ * \return empty string if not found.
+ */
+std::string resolveExecutable(const boost::filesystem::path &executable,
+                              const system::unistd::access::Id &ownerId) {
+  if (executable.string().find('/') != std::string::npos)
+    return executable.string();
+  const char *const path = std::getenv("PATH");
+  std::vector<std::string> dirs;
+  boost::algorithm::split(dirs, path ? path : "/bin:/usr/bin",
+                          boost::algorithm::is_any_of(":"));
+  for (const std::string &dir : dirs) {
+    // relative to child's current path, leave it to execvp(3)
+    if (dir.empty() || dir[0] != '/') return std::string();
+    const std::string candidate = (dir / executable).string();
+    // access(2) would check permissions of control process
+    if (executableBy(candidate, ownerId)) return candidate;
+  }
+  return std::string();
+}
+
+#ifdef SYS_setresuid32
+#define RAW_SETGROUPS SYS_setgroups32
+#define RAW_SETRESGID SYS_setresgid32
+#define RAW_SETRESUID SYS_setresuid32
+#else
+#define RAW_SETGROUPS SYS_setgroups
+#define RAW_SETRESGID SYS_setresgid
+#define RAW_SETRESUID SYS_setresuid
+#endif
+}  // namespace
+
 ProcessStarter::ProcessStarter(
-    const system::cgroup::ControlGroupPointer &controlGroup,
+    const ProcessControlGroupPointer &controlGroup,
     const AsyncProcessGroup::Process &process,
-    std::vector<system::unistd::Pipe> &pipes)
+    std::vector<system::unistd::Pipe> &pipes,
+    const StartBarrier *const startBarrier)
     : controlGroup_(controlGroup),
       ownerId_(process.ownerId),
       exec_(process.executable, process.arguments, process.environment),
       currentPath_(process.currentPath),
-      resourceLimits_(process.resourceLimits) {
-  setUpControlGroup();
+      resourceLimits_(process.resourceLimits),
+      resolvedExecutable_(
+          resolveExecutable(process.executable, process.ownerId)),
+      arguments_(process.arguments) {
+  for (const auto &var : process.environment)
+    environment_.push_back(var.first + "=" + var.second);
+  if (startBarrier) {
+    startBarrierReadyFd_ = startBarrier->readyFd();
+    startBarrierReleaseFd_ = startBarrier->releaseFd();
+  }
+  // control group is configured by ControlGroupPool
+  cpuNumber_ =
+      std::max<std::size_t>(parseCpuList(controlGroup_->cpus()).size(), 1);
   // TODO check that 0, 1, 2 are allocated
   std::unordered_set<int> childUsesFds;
   const Streams streams(pipes, allocatedFds_, process.currentPath,
@@ -77,26 +259,176 @@ ProcessStarter::ProcessStarter(
   for (const auto &fdStream : process.descriptors) {
     if (streams.isAlias(fdStream.second)) addStream(fdStream, true);
   }
-  // we do not want child process
-  // to interfere with parent
-  // so inherited fds should be closed
-  for (int fd = 0; fd <= 2; ++fd) childCloseFds_.insert(fd);
-  // close all not used fds
-  // note: all files are used, so we will check only pipes
-  for (const system::unistd::Pipe &pipe : pipes) {
-    if (pipe.readEndIsOpened() &&
-        childUsesFds.find(pipe.readEnd()) == childUsesFds.end()) {
-      childCloseFds_.insert(pipe.readEnd());
-    }
-    if (pipe.writeEndIsOpened() &&
-        childUsesFds.find(pipe.writeEnd()) == childUsesFds.end()) {
-      childCloseFds_.insert(pipe.writeEnd());
+  prepareFdPlan();
+}
+
+Pid ProcessStarter::cloneIntoControlGroup() {
+#ifdef HAVE_RAW_CLONE3_VFORK
+  if (cloneIntoCgroupUnsupported) return -1;
+  const boost::filesystem::path path = controlGroup_->cloneIntoPath();
+  if (path.empty()) return -1;
+  const system::unistd::Descriptor cgroupFd =
+      system::unistd::open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  CloneArgs args = {};
+  args.flags = CLONE_VM | CLONE_VFORK | CLONE_INTO_CGROUP;
+  args.exit_signal = SIGCHLD;
+  // kernel computes stack top itself
+  args.stack = reinterpret_cast<std::uintptr_t>(vforkStack_.data());
+  args.stack_size = vforkStackTop() - vforkStack_.data();
+  args.cgroup = cgroupFd.get();
+  long ret;
+  {
+    const SignalBlocker signalBlocker;
+    ret = rawClone3(&args, &ProcessStarter::vforkChild, this);
+  }
+  if (ret < 0) {
+    const int errno_ = -ret;
+    if (errno_ == ENOSYS || errno_ == E2BIG || errno_ == EINVAL) {
+      STREAM_DEBUG << "clone3(CLONE_INTO_CGROUP) is not supported, "
+                   << "falling back to clone().";
+      cloneIntoCgroupUnsupported = true;
+      return -1;
     }
+    BOOST_THROW_EXCEPTION(SystemError(errno_, "clone3"));
+  }
+  return ret;
+#else
+  return -1;
+#endif
+}
+
+bool ProcessStarter::prepareVfork() {
+  if (resolvedExecutable_.empty()) return false;
+  try {
+    outputLimit_.rlim_cur = outputLimit_.rlim_max =
+        boost::numeric_cast<rlim_t>(resourceLimits_.outputLimitBytes);
+    stackLimit_.rlim_cur = stackLimit_.rlim_max = RLIM_INFINITY;
+    numberOfProcessesLimit_.rlim_cur = numberOfProcessesLimit_.rlim_max =
+        boost::numeric_cast<rlim_t>(resourceLimits_.numberOfProcesses);
+  } catch (std::exception &e) {
+    STREAM_DEBUG << "Unable to prepare vfork due to \"" << e.what() << "\", "
+                 << "falling back to fork().";
+    return false;
+  }
+  for (std::string &arg : arguments_) argv_.push_back(&arg[0]);
+  argv_.push_back(nullptr);
+  for (std::string &var : environment_) envp_.push_back(&var[0]);
+  envp_.push_back(nullptr);
+  vforkStack_.resize(VFORK_STACK_SIZE);
+  return true;
+}
+
+char *ProcessStarter::vforkStackTop() {
+  // stack grows down on supported architectures
+  return reinterpret_cast<char *>(
+      reinterpret_cast<std::uintptr_t>(vforkStack_.data() +
+                                       vforkStack_.size()) &
+      ~static_cast<std::uintptr_t>(15));
+}
+
+Pid ProcessStarter::vforkChildProcess() {
+  if (!prepareVfork()) return -1;
+  const Pid pid = cloneIntoControlGroup();
+  if (pid >= 0) return pid;
+  try {
+    for (const boost::filesystem::path &attachFile :
+         controlGroup_->attachFiles())
+      tasksFiles_.push_back(
+          system::unistd::open(attachFile, O_WRONLY | O_CLOEXEC));
+  } catch (std::exception &e) {
+    STREAM_DEBUG << "Unable to open tasks files due to \"" << e.what()
+                 << "\", falling back to fork().";
+    tasksFiles_.clear();
+    return -1;
+  }
+  Pid clonePid;
+  int cloneErrno;
+  {
+    const SignalBlocker signalBlocker;
+    clonePid = ::clone(&ProcessStarter::vforkChild, vforkStackTop(),
+                       CLONE_VM | CLONE_VFORK | SIGCHLD, this);
+    cloneErrno = errno;
   }
+  tasksFiles_.clear();
+  if (clonePid < 0) BOOST_THROW_EXCEPTION(SystemError(cloneErrno, "clone"));
+  return clonePid;
+}
+
+int ProcessStarter::vforkChild(void *const starter_) noexcept {
+  const ProcessStarter &starter = *static_cast<ProcessStarter *>(starter_);
+
+  // inherited handlers belong to control process
+  for (int sig = 1; sig < NSIG; ++sig) {
+    struct ::sigaction act;
+    if (::sigaction(sig, nullptr, &act) < 0) continue;
+    if (act.sa_handler == SIG_IGN || act.sa_handler == SIG_DFL) continue;
+    act.sa_handler = SIG_DFL;
+    act.sa_flags = 0;
+    ::sigaction(sig, &act, nullptr);
+  }
+
+  // attach before descriptors setup, it closes tasks files,
+  // child born in control group has none
+  for (const system::unistd::Descriptor &tasks : starter.tasksFiles_) {
+    if (::write(tasks.get(), "0", 1) != 1)
+      vforkChildFailed(starter, "attach");
+  }
+
+  if (const char *const failed = runFdPlan(starter))
+    vforkChildFailed(starter, failed);
+
+  if (::setrlimit(RLIMIT_FSIZE, &starter.outputLimit_) < 0 ||
+      ::setrlimit(RLIMIT_STACK, &starter.stackLimit_) < 0)
+    vforkChildFailed(starter, "setrlimit");
+  if (::chdir(starter.currentPath_.c_str()) < 0)
+    vforkChildFailed(starter, "chdir");
+
+  // setuid(2) wrappers of glibc signal other threads of control process
+  const uid_t uid = starter.ownerId_.uid;
+  const gid_t gid = starter.ownerId_.gid;
+  if (::syscall(RAW_SETGROUPS, 1, &gid) < 0 ||
+      ::syscall(RAW_SETRESGID, gid, gid, gid) < 0 ||
+      ::syscall(RAW_SETRESUID, uid, uid, uid) < 0)
+    vforkChildFailed(starter, "setresuid");
+  if (::setrlimit(RLIMIT_NPROC, &starter.numberOfProcessesLimit_) < 0)
+    vforkChildFailed(starter, "setrlimit");
+
+  if (starter.startBarrierReadyFd_ >= 0 &&
+      !StartBarrier::arrive(starter.startBarrierReadyFd_,
+                            starter.startBarrierReleaseFd_))
+    vforkChildFailed(starter, "eventfd");
+
+  ::sigset_t mask;
+  sigemptyset(&mask);
+  if (::sigprocmask(SIG_SETMASK, &mask, nullptr) < 0)
+    vforkChildFailed(starter, "sigprocmask");
+  ::execve(starter.resolvedExecutable_.c_str(), starter.argv_.data(),
+           starter.envp_.data());
+  vforkChildFailed(starter, "execve");
+}
+
+void ProcessStarter::vforkChildFailed(const ProcessStarter &starter,
+                                      const char *const what) noexcept {
+  if (starter.startBarrierReadyFd_ >= 0)
+    StartBarrier::leave(starter.startBarrierReadyFd_);
+  const char prefix[] = "Unable to start due to failed ";
+  ssize_t ignored = ::write(STDERR_FILENO, prefix, sizeof(prefix) - 1);
+  ignored = ::write(STDERR_FILENO, what, std::strlen(what));
+  ignored = ::write(STDERR_FILENO, "\n", 1);
+  (void)ignored;
+  ::signal(SIG_START_FAILED, SIG_DFL);
+  ::sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIG_START_FAILED);
+  ::sigprocmask(SIG_UNBLOCK, &mask, nullptr);
+  ::kill(::syscall(SYS_getpid), SIG_START_FAILED);
+  ::_exit(1);
 }
 
 Pid ProcessStarter::operator()() {
-  const Pid pid = system::unistd::fork();
+  // child of fork() may use anything, it runs in its own memory
+  Pid pid = vforkChildProcess();
+  if (pid < 0) pid = system::unistd::fork();
   BOOST_ASSERT(pid >= 0);
   if (pid > 0) {  // parent
     STREAM_TRACE << "Child process was started pid = " << pid << ".";
@@ -113,6 +445,7 @@ void ProcessStarter::startChild() noexcept {
   try {
     // FIXME workaround, should be transmitted to control process
     Log::disableLogging();
+    childResetSignals();
     childSetUpFds();
     // TODO verify has permissions to execute
     childSetUpResourceLimits();
@@ -125,127 +458,88 @@ void ProcessStarter::startChild() noexcept {
     controlGroup_->attachSelf();
     system::unistd::access::dropId(ownerId_);
     childSetUpResourceLimitsUser();
+    if (startBarrierReadyFd_ >= 0 &&
+        !StartBarrier::arrive(startBarrierReadyFd_, startBarrierReleaseFd_))
+      BOOST_THROW_EXCEPTION(SystemError("eventfd"));
     // TODO usePath?
     exec_.execvpe();
   } catch (std::exception &e) {
     BUNSAN_LOG_FATAL_INTO(std::cerr) << "Unable to start due to: " << e.what();
-    ::raise(SIG_START_FAILED);
   } catch (...) {
     BUNSAN_LOG_FATAL_INTO(std::cerr) << "Unable to start due to unknown error";
-    ::raise(SIG_START_FAILED);
   }
+  if (startBarrierReadyFd_ >= 0) StartBarrier::leave(startBarrierReadyFd_);
+  ::raise(SIG_START_FAILED);
 }
 
-void ProcessStarter::childCloseFds() {
-  for (const int fd : childCloseFds_) system::unistd::close(fd);
+void ProcessStarter::childResetSignals() {
+  // control process blocks SIGCHLD, blocked signals are inherited by exec
+  ::sigset_t mask;
+  sigemptyset(&mask);
+  if (::sigprocmask(SIG_SETMASK, &mask, nullptr) < 0)
+    BOOST_THROW_EXCEPTION(SystemError("sigprocmask"));
 }
 
-class DescriptorMonitor : private boost::noncopyable {
- public:
-  DescriptorMonitor()
-      : maxFd_(system::unistd::getdtablesize()),
-        requiredFds_(maxFd_),
-        usedFds_(maxFd_),
-        freeFds_(maxFd_),
-        fdMap_(maxFd_) {
-    freeFds_.flip();  // freeFds = "111...11";
-  }
-
-  void setRequired(const int fd) {
-    requiredFds_.set(fd);
-    freeFds_.reset(fd);
-  }
-
-  void setUsed(const int fd) {
-    usedFds_.set(fd);
-    freeFds_.reset(fd);
-  }
-
-  void closeFd(const int fd) {
-    BOOST_ASSERT(usedFds_.test(fd));
-    system::unistd::close(fd);
-    usedFds_.reset(fd);
-    freeFds_.set(!requiredFds_.test(fd));
-  }
-
-  void copyFd(const int oldfd, const int newfd) {
-    BOOST_ASSERT(freeFds_.test(newfd) || requiredFds_.test(newfd));
-    system::unistd::dup2(oldfd, newfd);
-    freeFds_.reset(newfd);
-    usedFds_.set(newfd);
-  }
-
-  void moveFd(const int oldfd, const int newfd) {
-    copyFd(oldfd, newfd);
-    closeFd(oldfd);
-  }
-
-  void freeRequiredFds() {
-    boost::dynamic_bitset<> mustBeFreedFds = usedFds_ & requiredFds_;
-    for (std::size_t i = mustBeFreedFds.find_first(),
-                     freeFd = freeFds_.find_first();
-         i != boost::dynamic_bitset<>::npos;
-         i = mustBeFreedFds.find_next(i), freeFd = freeFds_.find_next(freeFd)) {
-      BOOST_ASSERT(freeFd != boost::dynamic_bitset<>::npos);
-      moveFd(i, freeFd);
-      mustBeFreedFds.reset(i);
-      fdMap_[i] = freeFd;
-      BOOST_ASSERT(!requiredFds_.test(freeFd));
-    }
-    BOOST_ASSERT(mustBeFreedFds.none());
-    BOOST_ASSERT(!usedFds_.intersects(requiredFds_));
-  }
-
-  int getMappedFd(const int fd) {
-    BOOST_ASSERT(0 < fd && static_cast<unsigned>(fd) < fdMap_.size());
-    return fdMap_[fd] ? fdMap_[fd] : fd;
-  }
-
-  void moveMappedFd(const int oldfd, const int newfd) {
-    moveFd(getMappedFd(oldfd), newfd);
+void ProcessStarter::prepareFdPlan() {
+  std::set<int> required, used;
+  for (const auto &fdStream : descriptors_) {
+    required.insert(fdStream.first);
+    used.insert(fdStream.second);
   }
-
-  ~DescriptorMonitor() { BOOST_ASSERT(usedFds_ == requiredFds_); }
-
- private:
-  const unsigned maxFd_;
-  boost::dynamic_bitset<> requiredFds_, usedFds_, freeFds_;
-  std::vector<int> fdMap_;
-};
-
-void ProcessStarter::childSetUpFds() {
-  // close unused descriptors
-  childCloseFds();
   /*
    * Here we need to move allocated resources
    * to descriptors that are not required
    * to be set.
    */
-  DescriptorMonitor fdMonitor;
+  // start barrier is above required descriptors and is closed by exec
+  std::set<int> kept = required;
+  if (startBarrierReadyFd_ >= 0) {
+    kept.insert(startBarrierReadyFd_);
+    kept.insert(startBarrierReleaseFd_);
+  }
+  int freeFd = 0;
+  std::unordered_map<int, int> moved;
+  for (const int fd : used) {
+    if (required.find(fd) == required.end()) continue;
+    while (kept.count(freeFd) || used.count(freeFd)) ++freeFd;
+    fdPlan_.emplace_back(fd, freeFd);
+    moved[fd] = freeFd++;
+  }
   for (const auto &fdStream : descriptors_) {
-    fdMonitor.setRequired(fdStream.first);
-    fdMonitor.setUsed(fdStream.second);
+    const auto iter = moved.find(fdStream.second);
+    const int fd = iter == moved.end() ? fdStream.second : iter->second;
+    fdPlan_.emplace_back(fd, fdStream.first);
+  }
+  // everything else is closed, including inherited 0, 1 and 2
+  unsigned first = 0;
+  for (const int fd : kept) {
+    if (first < static_cast<unsigned>(fd))
+      closeRanges_.emplace_back(first, fd - 1);
+    first = fd + 1;
   }
-  fdMonitor.freeRequiredFds();
-  for (const auto &fdStream : descriptors_)
-    fdMonitor.moveMappedFd(fdStream.second, fdStream.first);
+  closeRanges_.emplace_back(first, ~0U);
+  maxFd_ = system::unistd::getdtablesize();
 }
 
-void ProcessStarter::setUpControlGroup() {
-  system::cgroup::ControlGroupPointer parentCG = controlGroup_->parent();
-
-  const system::cgroup::CpuSet parentCpuSet(parentCG), cpuSet(controlGroup_);
-  cpuSet.setCpus(parentCpuSet.cpus());
-  cpuSet.setMems(parentCpuSet.mems());
-
-  const system::cgroup::Memory memory(controlGroup_);
-
-  // we do not want to count memory used by control process
-  cpuSet.setMemoryMigrate(false);
-  memory.setMoveChargeAtImmigrate(false, false);
+const char *ProcessStarter::runFdPlan(const ProcessStarter &starter) noexcept {
+  for (const auto &op : starter.fdPlan_) {
+    if (::dup2(op.first, op.second) < 0) return "dup2";
+  }
+  for (const auto &range : starter.closeRanges_) {
+    if (::syscall(SYS_close_range, range.first, range.second, 0) == 0)
+      continue;
+    if (errno != ENOSYS) return "close_range";
+    // old kernel, dup2() has not allocated anything above maxFd_
+    for (unsigned fd = range.first; fd <= range.second && fd < starter.maxFd_;
+         ++fd)
+      ::close(fd);
+  }
+  return nullptr;
+}
 
-  // we need oom-killer
-  if (memory.oomKillDisable()) memory.setOomKillDisable(false);
+void ProcessStarter::childSetUpFds() {
+  if (const char *const failed = runFdPlan(*this))
+    BOOST_THROW_EXCEPTION(SystemError(failed));
 }
 
 void ProcessStarter::childSetUpResourceLimits() {
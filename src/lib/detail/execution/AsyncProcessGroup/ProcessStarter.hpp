@@ -1,18 +1,23 @@
 #pragma once
 
 #include "ProcessInfo.hpp"
+#include "StartBarrier.hpp"
 
 #include <yandex/contest/invoker/detail/execution/AsyncProcessGroup.hpp>
 
-#include <yandex/contest/system/cgroup/ControlGroup.hpp>
 #include <yandex/contest/system/unistd/Descriptor.hpp>
 #include <yandex/contest/system/unistd/Exec.hpp>
 #include <yandex/contest/system/unistd/Pipe.hpp>
 
 #include <boost/noncopyable.hpp>
 
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
 
 namespace yandex {
 namespace contest {
@@ -23,22 +28,97 @@ namespace async_process_group_detail {
 
 class ProcessStarter : private boost::noncopyable {
  public:
-  ProcessStarter(const system::cgroup::ControlGroupPointer &controlGroup,
+  /*!
+   * \param startBarrier if set, child waits on it just before exec.
+   */
+  ProcessStarter(const ProcessControlGroupPointer &controlGroup,
                  const AsyncProcessGroup::Process &process,
-                 std::vector<system::unistd::Pipe> &pipes);
+                 std::vector<system::unistd::Pipe> &pipes,
+                 const StartBarrier *startBarrier = nullptr);
 
   /// Start process and return it's pid.
   Pid operator()();
 
+  /// Number of CPUs available to process.
+  std::size_t cpuNumber() const { return cpuNumber_; }
+
  private:
-  /// Never returns.
+  /*!
+   * \brief Start vforkChild() directly in its control group
+   * using clone3(CLONE_VM | CLONE_VFORK | CLONE_INTO_CGROUP).
+   *
+   * Supported only for cgroup v2 control groups
+   * on architectures with raw clone3(2) trampoline.
+   *
+   * \see ProcessControlGroup::cloneIntoPath()
+   *
+   * \return -1 if not supported.
+   */
+  Pid cloneIntoControlGroup();
+
+  /*!
+   * \brief Start child sharing memory with control process.
+   *
+   * Child runs vforkChild() on a dedicated stack until exec.
+   * Page tables are not copied, so spawn time
+   * does not depend on control process size.
+   * cloneIntoControlGroup() is tried first,
+   * clone(CLONE_VM | CLONE_VFORK) is used otherwise.
+   *
+   * \return -1 if process can't be started this way.
+   */
+  Pid vforkChildProcess();
+
+  /// 16-byte aligned top of vforkStack_.
+  char *vforkStackTop();
+
+  /*!
+   * \brief Precompute everything vforkChild() needs.
+   *
+   * \return false if process should be started by fork().
+   */
+  bool prepareVfork();
+
+  /*!
+   * \brief Child routine of vforkChildProcess().
+   *
+   * Async-signal-safe and allocation-free, never returns.
+   * The only routine allowed to run in child sharing memory.
+   */
+  static int vforkChild(void *starter) noexcept;
+
+  /// Report failed step to stderr and raise SIG_START_FAILED.
+  [[noreturn]] static void vforkChildFailed(const ProcessStarter &starter,
+                                            const char *what) noexcept;
+
+  /*!
+   * \brief Child routine of fork().
+   *
+   * Never returns.
+   *
+   * \warning Allocates, so it should never run in child sharing memory.
+   */
   void startChild() noexcept;
 
-  void childCloseFds();
+  void childResetSignals();
 
-  void childSetUpFds();
+  /*!
+   * \brief Compute descriptor operations for child.
+   *
+   * Allocated descriptors occupying required fds are moved away,
+   * then each one is duplicated into required fd,
+   * everything else is closed by close_range(2).
+   */
+  void prepareFdPlan();
 
-  void setUpControlGroup();
+  /*!
+   * \brief Execute fd plan, async-signal-safe and allocation-free.
+   *
+   * \return Failed call name or nullptr.
+   */
+  static const char *runFdPlan(const ProcessStarter &starter) noexcept;
+
+  void childSetUpFds();
 
   void childSetUpResourceLimits();
 
@@ -46,14 +126,34 @@ class ProcessStarter : private boost::noncopyable {
   void childSetUpResourceLimitsUser();
 
  private:
-  system::cgroup::ControlGroupPointer controlGroup_;
+  ProcessControlGroupPointer controlGroup_;
   system::unistd::access::Id ownerId_;
   system::unistd::Exec exec_;
   std::unordered_map<int, int> descriptors_;
   std::vector<system::unistd::Descriptor> allocatedFds_;
-  std::unordered_set<int> childCloseFds_;
   boost::filesystem::path currentPath_;
   process::ResourceLimits resourceLimits_;
+  std::size_t cpuNumber_ = 1;
+
+  /// StartBarrier descriptors, -1 if child starts immediately.
+  int startBarrierReadyFd_ = -1, startBarrierReleaseFd_ = -1;
+
+  /// dup2(first, second) operations.
+  std::vector<std::pair<int, int>> fdPlan_;
+
+  /// Inclusive ranges of descriptors closed in child.
+  std::vector<std::pair<unsigned, unsigned>> closeRanges_;
+
+  /// Fallback limit for kernels without close_range(2).
+  unsigned maxFd_ = 0;
+  std::string resolvedExecutable_;
+  std::vector<std::string> arguments_, environment_;
+  std::vector<char *> argv_, envp_;
+
+  /// Control group tasks files, child writes "0" to attach itself.
+  std::vector<system::unistd::Descriptor> tasksFiles_;
+  ::rlimit outputLimit_, stackLimit_, numberOfProcessesLimit_;
+  std::vector<char> vforkStack_;
 };
 
 }  // namespace async_process_group_detail
@@ -0,0 +1,67 @@
+#include "StartBarrier.hpp"
+
+#include <yandex/contest/StreamLog.hpp>
+#include <yandex/contest/SystemError.hpp>
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+namespace async_process_group_detail {
+
+namespace {
+int eventFd(const int minFd, const int flags) {
+  const int fd_ = ::eventfd(0, EFD_CLOEXEC | flags);
+  if (fd_ < 0) BOOST_THROW_EXCEPTION(SystemError("eventfd"));
+  const system::unistd::Descriptor fd(fd_);
+  const int moved = ::fcntl(fd.get(), F_DUPFD_CLOEXEC, minFd);
+  if (moved < 0) BOOST_THROW_EXCEPTION(SystemError("fcntl"));
+  return moved;
+}
+}  // namespace
+
+StartBarrier::StartBarrier(const int minFd)
+    : ready_(eventFd(minFd, 0)), release_(eventFd(minFd, EFD_SEMAPHORE)) {}
+
+bool StartBarrier::arrive(const int readyFd, const int releaseFd) noexcept {
+  if (::eventfd_write(readyFd, 1) < 0) return false;
+  ::eventfd_t value;
+  while (::eventfd_read(releaseFd, &value) < 0) {
+    if (errno != EINTR) return false;
+  }
+  return true;
+}
+
+void StartBarrier::leave(const int readyFd) noexcept {
+  ::eventfd_write(readyFd, 1);
+}
+
+void StartBarrier::release(const std::size_t number) {
+  STREAM_TRACE << "Waiting for " << number << " children to be ready...";
+  std::size_t ready = 0;
+  while (ready < number) {
+    ::eventfd_t value;
+    if (::eventfd_read(ready_.get(), &value) < 0) {
+      if (errno == EINTR) continue;
+      BOOST_THROW_EXCEPTION(SystemError("eventfd_read"));
+    }
+    ready += value;
+  }
+  if (::eventfd_write(release_.get(), number) < 0)
+    BOOST_THROW_EXCEPTION(SystemError("eventfd_write"));
+  STREAM_TRACE << "Children were released.";
+}
+
+}  // namespace async_process_group_detail
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
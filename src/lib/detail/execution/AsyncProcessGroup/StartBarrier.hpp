@@ -0,0 +1,63 @@
+#pragma once
+
+#include <yandex/contest/system/unistd/Descriptor.hpp>
+
+#include <boost/noncopyable.hpp>
+
+#include <cstddef>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+namespace async_process_group_detail {
+
+/*!
+ * \brief Releases children of process group simultaneously.
+ *
+ * Each child reports that it is ready by incrementing readyFd()
+ * and blocks on releaseFd() until release() is called,
+ * so the last child does not start much later than the first one.
+ */
+class StartBarrier : private boost::noncopyable {
+ public:
+  /*!
+   * \param minFd descriptors are allocated not below minFd
+   * so they do not clash with descriptors required by children.
+   */
+  explicit StartBarrier(int minFd);
+
+  int readyFd() const { return ready_.get(); }
+  int releaseFd() const { return release_.get(); }
+
+  /*!
+   * \brief Child side, async-signal-safe.
+   *
+   * \return false on error.
+   */
+  static bool arrive(int readyFd, int releaseFd) noexcept;
+
+  /*!
+   * \brief Should be called instead of arrive()
+   * if child failed or was not started.
+   *
+   * Async-signal-safe. Calling it after arrive()
+   * only makes release() return earlier.
+   */
+  static void leave(int readyFd) noexcept;
+
+  /// Wait until number of children arrived or left and release them.
+  void release(std::size_t number);
+
+ private:
+  system::unistd::Descriptor ready_;
+  system::unistd::Descriptor release_;
+};
+
+}  // namespace async_process_group_detail
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
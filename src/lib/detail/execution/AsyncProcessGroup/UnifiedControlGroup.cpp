@@ -0,0 +1,493 @@
+#include "UnifiedControlGroup.hpp"
+
+#include <yandex/contest/system/unistd/Operations.hpp>
+
+#include <yandex/contest/StreamLog.hpp>
+#include <yandex/contest/SystemError.hpp>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <linux/magic.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+#ifndef CGROUP2_SUPER_MAGIC
+#define CGROUP2_SUPER_MAGIC 0x63677270
+#endif
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+namespace async_process_group_detail {
+
+namespace {
+const boost::filesystem::path mountPoint = "/sys/fs/cgroup";
+
+/// Leaf for processes of control group with children.
+const char leafName[] = "control";
+
+std::string readFd(const int fd) {
+  std::string data;
+  char buffer[4096];
+  for (;;) {
+    const ssize_t size = ::pread(fd, buffer, sizeof(buffer), data.size());
+    if (size < 0) {
+      if (errno == EINTR) continue;
+      BOOST_THROW_EXCEPTION(SystemError("pread"));
+    }
+    if (size == 0) return data;
+    data.append(buffer, size);
+  }
+}
+
+std::string readFile(const boost::filesystem::path &path) {
+  const system::unistd::Descriptor fd =
+      system::unistd::open(path, O_RDONLY | O_CLOEXEC);
+  return readFd(fd.get());
+}
+
+/// Control files expect a value in a single write.
+void writeFile(const boost::filesystem::path &path, const std::string &value) {
+  const system::unistd::Descriptor fd =
+      system::unistd::open(path, O_WRONLY | O_CLOEXEC);
+  const ssize_t size = ::write(fd.get(), value.data(), value.size());
+  if (size < 0) BOOST_THROW_EXCEPTION(SystemError("write"));
+  if (static_cast<std::size_t>(size) != value.size())
+    BOOST_THROW_EXCEPTION(SystemError(EIO, "write"));
+}
+
+std::unordered_map<std::string, std::string> parseKeyed(
+    const std::string &data) {
+  std::unordered_map<std::string, std::string> keyed;
+  std::istringstream in(data);
+  std::string key, value;
+  while (in >> key >> value) keyed[key] = value;
+  return keyed;
+}
+
+/// Remove empty control group with its empty descendants.
+void removeTree(const boost::filesystem::path &path) {
+  for (boost::filesystem::directory_iterator i(path), end; i != end; ++i) {
+    if (boost::filesystem::is_directory(i->symlink_status()))
+      removeTree(i->path());
+  }
+  if (::rmdir(path.c_str()) < 0) BOOST_THROW_EXCEPTION(SystemError("rmdir"));
+}
+
+template <typename T>
+T fromString(const std::string &value) {
+  return boost::lexical_cast<T>(boost::algorithm::trim_copy(value));
+}
+}  // namespace
+
+bool UnifiedControlGroup::mounted() {
+  struct ::statfs fs;
+  if (::statfs(mountPoint.c_str(), &fs) < 0) return false;
+  return fs.f_type == CGROUP2_SUPER_MAGIC;
+}
+
+ProcessControlGroupPointer UnifiedControlGroup::forSelf() {
+  boost::filesystem::path path;
+  std::istringstream in(readFile("/proc/self/cgroup"));
+  for (std::string line; std::getline(in, line);) {
+    if (boost::algorithm::starts_with(line, "0::"))
+      path = mountPoint / boost::filesystem::path(line.substr(3))
+                              .relative_path();
+  }
+  if (path.empty())
+    BOOST_THROW_EXCEPTION(Error() << Error::message(
+                              "Process is not in cgroup v2 hierarchy."));
+  // long-lived control process calls this for every task,
+  // it has been moved to the leaf by the first call
+  if (path.filename() == leafName) path = path.parent_path();
+  if (path != mountPoint) {
+    // "no internal processes" rule: controllers are enabled for children
+    // only if control group itself has no processes
+    const boost::filesystem::path leaf = path / leafName;
+    if (!boost::filesystem::exists(leaf)) system::unistd::mkdir(leaf, 0700);
+    UnifiedControlGroup self(path, false);
+    for (const pid_t pid : self.procs()) {
+      try {
+        writeFile(leaf / "cgroup.procs", std::to_string(pid));
+      } catch (SystemError &) {
+        // process may have terminated
+        if (::kill(pid, 0) == 0) throw;
+      }
+    }
+  }
+  std::vector<std::string> controllers;
+  const std::string available =
+      boost::algorithm::trim_copy(readFile(path / "cgroup.controllers"));
+  boost::algorithm::split(controllers, available,
+                          boost::algorithm::is_space(),
+                          boost::algorithm::token_compress_on);
+  for (const std::string &controller : controllers) {
+    if (controller == "cpu" || controller == "cpuset" ||
+        controller == "io" || controller == "memory" || controller == "pids")
+      writeFile(path / "cgroup.subtree_control", "+" + controller);
+  }
+  STREAM_DEBUG << "Using cgroup v2 control group " << path << ".";
+  return std::make_shared<UnifiedControlGroup>(path, false);
+}
+
+UnifiedControlGroup::UnifiedControlGroup(const boost::filesystem::path &path,
+                                         const bool owned)
+    : path_(path), owned_(owned) {}
+
+UnifiedControlGroup::~UnifiedControlGroup() {
+  if (!owned_) return;
+  try {
+    terminate();
+    removeTree(path_);
+  } catch (std::exception &e) {
+    STREAM_ERROR << "Unable to remove " << path_ << " due to \"" << e.what()
+                 << "\" (ignoring).";
+  }
+}
+
+ProcessControlGroupPointer UnifiedControlGroup::createChild(
+    const std::string &name) {
+  const boost::filesystem::path path = path_ / name;
+  system::unistd::mkdir(path, 0700);
+  return std::make_shared<UnifiedControlGroup>(path, true);
+}
+
+void UnifiedControlGroup::configure() {
+  // cpuset is inherited from parent, oom-killer can't be disabled
+}
+
+bool UnifiedControlGroup::reset() {
+  // there is no memory.force_empty: page cache of previous run
+  // stays charged, and memory.peak can't be lowered by baselines,
+  // so pooling is cgroup v1 only
+  return false;
+}
+
+std::string UnifiedControlGroup::cpus() const {
+  const boost::filesystem::path effective = path_ / "cpuset.cpus.effective";
+  return boost::algorithm::trim_copy(
+      readFile(boost::filesystem::exists(effective)
+                   ? effective
+                   : "/sys/devices/system/cpu/online"));
+}
+
+void UnifiedControlGroup::setCpus(const std::string &cpus) {
+  const boost::filesystem::path field = path_ / "cpuset.cpus";
+  if (!boost::filesystem::exists(field))
+    BOOST_THROW_EXCEPTION(Error() << Error::message(
+                              "cpuset controller is not enabled."));
+  writeFile(field, cpus);
+}
+
+std::string UnifiedControlGroup::mems() const {
+  const boost::filesystem::path effective = path_ / "cpuset.mems.effective";
+  return boost::algorithm::trim_copy(
+      readFile(boost::filesystem::exists(effective)
+                   ? effective
+                   : "/sys/devices/system/node/online"));
+}
+
+bool UnifiedControlGroup::empty() const {
+  return readKeyed("cgroup.events").at("populated") == "0";
+}
+
+void UnifiedControlGroup::attachSelf() {
+  writeFile(path_ / "cgroup.procs", "0");
+}
+
+std::vector<boost::filesystem::path> UnifiedControlGroup::attachFiles()
+    const {
+  return {path_ / "cgroup.procs"};
+}
+
+boost::filesystem::path UnifiedControlGroup::cloneIntoPath() const {
+  return path_;
+}
+
+boost::filesystem::path UnifiedControlGroup::perfEventPath() const {
+  return path_;
+}
+
+void UnifiedControlGroup::terminate() {
+  if (empty()) return;
+  const boost::filesystem::path kill = path_ / "cgroup.kill";
+  if (boost::filesystem::exists(kill)) {
+    // kernel kills every process including those being forked
+    writeFile(kill, "1");
+  } else {
+    // frozen processes can't fork, so single pass is enough
+    freeze();
+    try {
+      for (const pid_t pid : procs()) {
+        if (::kill(pid, SIGKILL) < 0 && errno != ESRCH)
+          BOOST_THROW_EXCEPTION(SystemError("kill"));
+      }
+    } catch (...) {
+      unfreeze();
+      throw;
+    }
+    unfreeze();
+  }
+  if (!waitEvent("populated", "0", terminationTimeout))
+    STREAM_ERROR << "Killed processes of " << path_ << " "
+                 << "have not exited in time.";
+}
+
+ProcessControlGroup::CpuUsage UnifiedControlGroup::cpuUsage() const {
+  const auto stat = readKeyed("cpu.stat");
+  const auto get = [&stat](const std::string &key) {
+    return std::chrono::microseconds(
+        fromString<std::chrono::microseconds::rep>(stat.at(key)));
+  };
+  CpuUsage usage;
+  usage.user = get("user_usec");
+  usage.system = get("system_usec");
+  usage.total = get("usage_usec");
+  return usage;
+}
+
+boost::optional<ProcessControlGroup::Pressure> UnifiedControlGroup::pressure(
+    const std::string &resource) const {
+  std::string data;
+  try {
+    // missing or unreadable if kernel is booted with psi=0
+    data = readFile(path_ / (resource + ".pressure"));
+  } catch (SystemError &) {
+    return boost::none;
+  }
+  // some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+  Pressure pressure;
+  std::istringstream in(data);
+  for (std::string line; std::getline(in, line);) {
+    std::istringstream fields(line);
+    std::string kind, field;
+    fields >> kind;
+    while (fields >> field) {
+      if (!boost::algorithm::starts_with(field, "total=")) continue;
+      const std::chrono::microseconds total(
+          fromString<std::chrono::microseconds::rep>(field.substr(6)));
+      if (kind == "some") pressure.some = total;
+      if (kind == "full") pressure.full = total;
+    }
+  }
+  return pressure;
+}
+
+boost::optional<ProcessControlGroup::CpuThrottling>
+UnifiedControlGroup::cpuThrottling() const {
+  const auto stat = readKeyed("cpu.stat");
+  // bandwidth statistics are present if cpu controller is enabled
+  const auto periods = stat.find("nr_throttled");
+  const auto time = stat.find("throttled_usec");
+  if (periods == stat.end() || time == stat.end()) return boost::none;
+  CpuThrottling throttling;
+  throttling.periods = fromString<std::uint64_t>(periods->second);
+  throttling.time = std::chrono::microseconds(
+      fromString<std::chrono::microseconds::rep>(time->second));
+  return throttling;
+}
+
+boost::optional<ProcessControlGroup::IoUsage> UnifiedControlGroup::ioUsage()
+    const {
+  // present if io controller is enabled
+  const boost::filesystem::path stat = path_ / "io.stat";
+  if (!boost::filesystem::exists(stat)) return boost::none;
+  // 8:0 rbytes=0 wbytes=0 rios=0 wios=0 dbytes=0 dios=0
+  IoUsage usage;
+  std::istringstream in(readFile(stat));
+  for (std::string line; std::getline(in, line);) {
+    std::istringstream fields(line);
+    std::string device, field;
+    fields >> device;
+    while (fields >> field) {
+      const std::size_t eq = field.find('=');
+      if (eq == std::string::npos) continue;
+      const std::string key = field.substr(0, eq);
+      const auto value = fromString<std::uint64_t>(field.substr(eq + 1));
+      if (key == "rbytes") usage.readBytes += value;
+      if (key == "wbytes") usage.writeBytes += value;
+      if (key == "rios") usage.readOperations += value;
+      if (key == "wios") usage.writeOperations += value;
+    }
+  }
+  return usage;
+}
+
+void UnifiedControlGroup::setIoLimits(const IoLimits &ioLimits) {
+  const auto limit = [](const std::uint64_t value) {
+    return value == std::numeric_limits<std::uint64_t>::max()
+               ? std::string("max")
+               : std::to_string(value);
+  };
+  const std::string limits = " rbps=" + limit(ioLimits.readBytes) +
+                             " wbps=" + limit(ioLimits.writeBytes) +
+                             " riops=" + limit(ioLimits.readOperations) +
+                             " wiops=" + limit(ioLimits.writeOperations);
+  // io.max accepts whole disks only, they are listed in /sys/block
+  std::size_t limited = 0;
+  for (boost::filesystem::directory_iterator i("/sys/block"), end; i != end;
+       ++i) {
+    const std::string device =
+        boost::algorithm::trim_copy(readFile(i->path() / "dev"));
+    try {
+      writeFile(path_ / "io.max", device + limits);
+      ++limited;
+    } catch (SystemError &e) {
+      STREAM_DEBUG << "Unable to limit I/O of " << i->path() << " due to \""
+                   << e.what() << "\" (ignoring).";
+    }
+  }
+  if (!limited)
+    BOOST_THROW_EXCEPTION(
+        Error() << Error::message("Unable to limit I/O of any disk."));
+}
+
+ProcessControlGroup::MemoryStat UnifiedControlGroup::memoryStat() const {
+  const auto stat = readKeyed("memory.stat");
+  const auto get = [&stat](const std::string &key) -> std::uint64_t {
+    const auto iter = stat.find(key);
+    return iter == stat.end() ? 0 : fromString<std::uint64_t>(iter->second);
+  };
+  MemoryStat memoryStat;
+  memoryStat.anonymous = get("anon");
+  memoryStat.pageCache = get("file");
+  memoryStat.shared = get("shmem");
+  // "kernel" is available since Linux 5.18
+  memoryStat.kernel =
+      stat.count("kernel")
+          ? get("kernel")
+          : get("kernel_stack") + get("pagetables") + get("percpu") +
+                get("sock") + get("slab");
+  const boost::filesystem::path swap = path_ / "memory.swap.current";
+  if (boost::filesystem::exists(swap))
+    memoryStat.swap = fromString<std::uint64_t>(readFile(swap));
+  return memoryStat;
+}
+
+boost::optional<std::uint64_t> UnifiedControlGroup::peakMemoryUsage() const {
+  // memory.peak is available since Linux 5.19,
+  // memory.current is not a substitute: it is zero once processes exit
+  const boost::filesystem::path peak = path_ / "memory.peak";
+  if (!boost::filesystem::exists(peak)) return boost::none;
+  return fromString<std::uint64_t>(readFile(peak));
+}
+
+boost::optional<std::uint64_t> UnifiedControlGroup::peakMemorySwapUsage()
+    const {
+  // memory.swap.peak is available since Linux 6.5
+  const boost::filesystem::path swapPeak = path_ / "memory.swap.peak";
+  const boost::optional<std::uint64_t> peak = peakMemoryUsage();
+  if (!peak || !boost::filesystem::exists(swapPeak)) return boost::none;
+  // there is no combined counter, peaks may not coincide
+  return *peak + fromString<std::uint64_t>(readFile(swapPeak));
+}
+
+void UnifiedControlGroup::setMemoryLimit(const std::uint64_t memoryLimitBytes) {
+  if (memoryLimitBytes >= std::numeric_limits<std::int64_t>::max()) return;
+  writeFile(path_ / "memory.max", std::to_string(memoryLimitBytes));
+  // process is not left half-killed
+  const boost::filesystem::path oomGroup = path_ / "memory.oom.group";
+  if (boost::filesystem::exists(oomGroup)) writeFile(oomGroup, "1");
+}
+
+boost::optional<std::uint64_t> UnifiedControlGroup::oomKills() const {
+  const auto events = readKeyed("memory.events");
+  // "oom_kill" is available since Linux 4.13
+  const auto oomKill = events.find("oom_kill");
+  if (oomKill == events.end()) return boost::none;
+  return fromString<std::uint64_t>(oomKill->second);
+}
+
+std::uint64_t UnifiedControlGroup::memoryLimitHits() const {
+  const auto events = readKeyed("memory.events");
+  const auto max = events.find("max");
+  if (max == events.end()) return 0;
+  return fromString<std::uint64_t>(max->second);
+}
+
+std::unique_ptr<MemoryUsageWatcher> UnifiedControlGroup::watchMemoryUsage(
+    const std::uint64_t /*memoryLimitBytes*/) {
+  // memory.high is not used: it throttles processes near the limit,
+  // hitting memory.max and oom kills are reported by memory.events,
+  // memory usage is sampled periodically,
+  // see MemoryUsageWatcher::notifiesThresholds()
+  return std::unique_ptr<MemoryUsageWatcher>(
+      new MemoryUsageWatcher(path_ / "memory.events"));
+}
+
+void UnifiedControlGroup::print(std::ostream &out) const { out << path_; }
+
+void UnifiedControlGroup::freeze() {
+  writeFile(path_ / "cgroup.freeze", "1");
+  // tasks in uninterruptible sleep may delay freezing,
+  // SIGKILL is delivered to them anyway
+  if (!waitEvent("frozen", "1", terminationTimeout))
+    STREAM_DEBUG << path_ << " has not been frozen in time.";
+}
+
+void UnifiedControlGroup::unfreeze() {
+  writeFile(path_ / "cgroup.freeze", "0");
+}
+
+void UnifiedControlGroup::writeField(const std::string &field,
+                                     const std::string &value) {
+  writeFile(path_ / field, value);
+}
+
+std::unordered_set<pid_t> UnifiedControlGroup::procs() const {
+  std::unordered_set<pid_t> pids;
+  std::istringstream in(readFile(path_ / "cgroup.procs"));
+  pid_t pid;
+  while (in >> pid) pids.insert(pid);
+  return pids;
+}
+
+bool UnifiedControlGroup::waitEvent(
+    const std::string &key, const std::string &value,
+    const std::chrono::milliseconds timeout) const {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  const system::unistd::Descriptor events =
+      system::unistd::open(path_ / "cgroup.events", O_RDONLY | O_CLOEXEC);
+  // modification is reported by POLLPRI
+  ::pollfd fd = {events.get(), POLLPRI, 0};
+  while (parseKeyed(readFd(events.get())).at(key) != value) {
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= deadline) return false;
+    // do not rely on notification only
+    const auto wait = std::min<std::chrono::milliseconds::rep>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now)
+                .count() + 1,
+        100);
+    if (::poll(&fd, 1, wait) < 0 && errno != EINTR)
+      BOOST_THROW_EXCEPTION(SystemError("poll"));
+  }
+  return true;
+}
+
+std::unordered_map<std::string, std::string> UnifiedControlGroup::readKeyed(
+    const std::string &field) const {
+  return parseKeyed(readFile(path_ / field));
+}
+
+}  // namespace async_process_group_detail
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
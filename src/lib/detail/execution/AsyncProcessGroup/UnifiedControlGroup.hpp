@@ -0,0 +1,102 @@
+#pragma once
+
+#include "ProcessControlGroup.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <sys/types.h>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+namespace async_process_group_detail {
+
+/*!
+ * \brief ProcessControlGroup in cgroup v2 unified hierarchy.
+ *
+ * Accounting is read from cpu.stat, memory.stat and memory.peak,
+ * processes are killed by a single write to cgroup.kill
+ * where supported, by freezing through cgroup.freeze otherwise.
+ */
+class UnifiedControlGroup : public ProcessControlGroup {
+ public:
+  /// Unified hierarchy is mounted at /sys/fs/cgroup.
+  static bool mounted();
+
+  /*!
+   * \brief Control group of current process.
+   *
+   * Processes of this control group are moved to "control" leaf
+   * so controllers can be enabled for children.
+   * If current process is already in that leaf its parent is returned,
+   * so repeated calls do not nest.
+   */
+  static ProcessControlGroupPointer forSelf();
+
+  /// \param owned control group is removed on destruction.
+  UnifiedControlGroup(const boost::filesystem::path &path, bool owned);
+
+  ~UnifiedControlGroup() override;
+
+  ProcessControlGroupPointer createChild(const std::string &name) override;
+  void configure() override;
+  bool reset() override;
+  std::string cpus() const override;
+  void setCpus(const std::string &cpus) override;
+  std::string mems() const override;
+  bool empty() const override;
+  void attachSelf() override;
+  std::vector<boost::filesystem::path> attachFiles() const override;
+  boost::filesystem::path cloneIntoPath() const override;
+  boost::filesystem::path perfEventPath() const override;
+  void terminate() override;
+  CpuUsage cpuUsage() const override;
+  boost::optional<Pressure> pressure(
+      const std::string &resource) const override;
+  boost::optional<CpuThrottling> cpuThrottling() const override;
+  boost::optional<IoUsage> ioUsage() const override;
+  void setIoLimits(const IoLimits &ioLimits) override;
+  MemoryStat memoryStat() const override;
+  boost::optional<std::uint64_t> peakMemoryUsage() const override;
+  boost::optional<std::uint64_t> peakMemorySwapUsage() const override;
+  void setMemoryLimit(std::uint64_t memoryLimitBytes) override;
+  boost::optional<std::uint64_t> oomKills() const override;
+  std::uint64_t memoryLimitHits() const override;
+  std::unique_ptr<MemoryUsageWatcher> watchMemoryUsage(
+      std::uint64_t memoryLimitBytes) override;
+  void freeze() override;
+  void unfreeze() override;
+  void writeField(const std::string &field,
+                  const std::string &value) override;
+  void print(std::ostream &out) const override;
+
+  std::unordered_set<pid_t> procs() const;
+
+ private:
+  /*!
+   * \brief Wait until key has value in cgroup.events.
+   *
+   * \return false on timeout.
+   */
+  bool waitEvent(const std::string &key, const std::string &value,
+                 std::chrono::milliseconds timeout) const;
+
+  /// Parse "key value" lines.
+  std::unordered_map<std::string, std::string> readKeyed(
+      const std::string &field) const;
+
+ private:
+  const boost::filesystem::path path_;
+  const bool owned_;
+};
+
+}  // namespace async_process_group_detail
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
@@ -1,5 +1,8 @@
 #include <yandex/contest/invoker/detail/execution/AsyncProcessGroup.hpp>
 
+#include <yandex/contest/invoker/detail/execution/ControlProcessDaemon.hpp>
+
+#include "BatchExecutor.hpp"
 #include "ProcessGroupStarter.hpp"
 
 namespace yandex {
@@ -14,6 +17,16 @@ AsyncProcessGroup::Result AsyncProcessGroup::execute(const Task &task) {
   return starter.result();
 }
 
+void AsyncProcessGroup::execute(const BatchTask &batch,
+                                const BatchCallback &callback) {
+  async_process_group_detail::BatchExecutor executor(batch, callback);
+  executor.executionLoop();
+}
+
+void AsyncProcessGroup::serve(const int in, const int out) {
+  ControlProcessDaemon::serve(in, out);
+}
+
 }  // namespace execution
 }  // namespace detail
 }  // namespace invoker
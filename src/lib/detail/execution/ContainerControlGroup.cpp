@@ -0,0 +1,52 @@
+#include <yandex/contest/invoker/detail/execution/ContainerControlGroup.hpp>
+
+#include "AsyncProcessGroup/ProcessControlGroup.hpp"
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+
+class ContainerControlGroup::Impl {
+ public:
+  explicit Impl(const std::string &name)
+      : controlGroup(async_process_group_detail::ProcessControlGroup::forSelf()
+                         ->createChild(name)) {
+    controlGroup->configure();
+  }
+
+  const async_process_group_detail::ProcessControlGroupPointer controlGroup;
+};
+
+ContainerControlGroup::ContainerControlGroup(const std::string &name)
+    : pimpl(new Impl(name)) {}
+
+ContainerControlGroup::~ContainerControlGroup() {}
+
+std::vector<boost::filesystem::path> ContainerControlGroup::attachFiles()
+    const {
+  return pimpl->controlGroup->attachFiles();
+}
+
+void ContainerControlGroup::terminate() { pimpl->controlGroup->terminate(); }
+
+void ContainerControlGroup::freeze() { pimpl->controlGroup->freeze(); }
+
+void ContainerControlGroup::unfreeze() { pimpl->controlGroup->unfreeze(); }
+
+void ContainerControlGroup::writeField(const std::string &field,
+                                       const std::string &value) {
+  pimpl->controlGroup->writeField(field, value);
+}
+
+std::ostream &operator<<(std::ostream &out,
+                         const ContainerControlGroup &controlGroup) {
+  return out << *controlGroup.pimpl->controlGroup;
+}
+
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
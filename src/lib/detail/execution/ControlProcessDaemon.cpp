@@ -0,0 +1,405 @@
+#include <yandex/contest/invoker/detail/execution/ControlProcessDaemon.hpp>
+
+#include <yandex/contest/invoker/detail/execution/AsyncProcessGroup.hpp>
+
+#include <yandex/contest/system/unistd/Exec.hpp>
+#include <yandex/contest/system/unistd/Operations.hpp>
+
+#include <yandex/contest/SerializationCast.hpp>
+#include <yandex/contest/StreamLog.hpp>
+#include <yandex/contest/SystemError.hpp>
+
+#include <boost/assert.hpp>
+
+#include <array>
+
+#include <cstdint>
+#include <cstring>
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace detail {
+namespace execution {
+
+namespace {
+/*!
+ * Frame layout: type byte, payload size in host byte order, payload.
+ *
+ * Requests carry serialized Task or BatchTask.
+ * Responses carry serialized Result, error message
+ * or serialized BatchResult for every task of the batch.
+ * Failed batch is terminated by error message.
+ */
+enum RequestType : char { REQUEST_TASK = 0, REQUEST_BATCH = 1 };
+
+enum ResponseType : char {
+  RESPONSE_RESULT = 0,
+  RESPONSE_ERROR = 1,
+  RESPONSE_BATCH_RESULT = 2
+};
+
+constexpr std::size_t frameHeaderSize = 1 + sizeof(std::uint64_t);
+
+std::string frameHeader(const char type, const std::size_t size) {
+  const std::uint64_t size_ = size;
+  std::string header(frameHeaderSize, type);
+  std::memcpy(&header[1], &size_, sizeof(size_));
+  return header;
+}
+
+std::uint64_t frameSize(const std::string &header) {
+  BOOST_ASSERT(header.size() >= frameHeaderSize);
+  std::uint64_t size;
+  std::memcpy(&size, &header[1], sizeof(size));
+  return size;
+}
+
+void sendAll(const int fd, const std::string &data) {
+  std::size_t sent = 0;
+  while (sent < data.size()) {
+    const ssize_t size =
+        ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (size < 0) {
+      if (errno == EINTR) continue;
+      BOOST_THROW_EXCEPTION(SystemError("send"));
+    }
+    sent += size;
+  }
+}
+
+void sendFrame(const int fd, const char type, const std::string &payload) {
+  sendAll(fd, frameHeader(type, payload.size()) + payload);
+}
+
+AsyncProcessGroupControlProcessError protocolError(const std::string &what) {
+  // the same as failed single-task control process
+  system::execution::Result result;
+  result.exitStatus = 1;
+  result.err = what;
+  return AsyncProcessGroupControlProcessError(result);
+}
+
+/// \return false on EOF before the first byte.
+bool readAll(const int fd, std::string &data, const std::size_t size) {
+  data.resize(size);
+  std::size_t received = 0;
+  while (received < size) {
+    const ssize_t size_ = ::read(fd, &data[received], size - received);
+    if (size_ < 0) {
+      if (errno == EINTR) continue;
+      BOOST_THROW_EXCEPTION(SystemError("read"));
+    }
+    if (size_ == 0) {
+      if (received == 0) return false;
+      BOOST_THROW_EXCEPTION(AsyncProcessGroupError()
+                            << Error::message("Truncated frame."));
+    }
+    received += size_;
+  }
+  return true;
+}
+
+/// \return false on EOF.
+bool readFrame(const int fd, char &type, std::string &payload) {
+  std::string header;
+  if (!readAll(fd, header, frameHeaderSize)) return false;
+  type = header[0];
+  if (!readAll(fd, payload, frameSize(header)))
+    BOOST_THROW_EXCEPTION(AsyncProcessGroupError()
+                          << Error::message("Truncated frame."));
+  return true;
+}
+}  // namespace
+
+ControlProcessDaemon::ControlProcessDaemon(
+    const system::execution::AsyncProcess::Options &options,
+    const Terminator &terminator)
+    : ControlProcessDaemon([&options](const std::function<void()> &setUp) {
+        system::unistd::Exec exec(options.executable, options.arguments,
+                                  options.environment);
+        const pid_t pid = system::unistd::fork();
+        if (pid == 0) {
+          try {
+            setUp();
+            if (options.usePath)
+              exec.execvp();
+            else
+              exec.execv();
+          } catch (...) {
+          }
+          ::_exit(1);
+        }
+        return pid;
+      }, terminator) {}
+
+ControlProcessDaemon::ControlProcessDaemon(const Spawner &spawner,
+                                           const Terminator &terminator)
+    : terminator_(terminator) {
+  int fds[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0)
+    BOOST_THROW_EXCEPTION(SystemError("socketpair"));
+  system::unistd::Descriptor parentEnd(fds[0]), childEnd(fds[1]);
+  STREAM_INFO << "Trying to start persistent control process.";
+  pid_ = spawner([&parentEnd, &childEnd] {
+    // child may not exec, so parent's end is closed explicitly
+    parentEnd.close();
+    // note: dup2() clears FD_CLOEXEC
+    system::unistd::dup2(childEnd.get(), STDIN_FILENO);
+    system::unistd::dup2(childEnd.get(), STDOUT_FILENO);
+  });
+  socket_ = std::move(parentEnd);
+  STREAM_INFO << "Persistent control process was started pid = " << pid_
+              << ".";
+}
+
+ControlProcessDaemon::~ControlProcessDaemon() {
+  try {
+    close();
+  } catch (std::exception &e) {
+    STREAM_ERROR << "Unable to close persistent control process due to \""
+                 << e.what() << "\" (ignoring).";
+  }
+}
+
+bool ControlProcessDaemon::running() const { return pid_ > 0; }
+
+bool ControlProcessDaemon::busy() const { return busy_; }
+
+std::size_t ControlProcessDaemon::pending() const { return pending_; }
+
+void ControlProcessDaemon::start(const Task &task) {
+  BOOST_ASSERT(running());
+  BOOST_ASSERT(!busy());
+  STREAM_TRACE << "Attempt to execute process group: " << STREAM_OBJECT(task);
+  send(REQUEST_TASK, serialization::serialize(task));
+}
+
+boost::optional<ControlProcessDaemon::Result> ControlProcessDaemon::poll() {
+  if (!busy() || pending()) noTask();
+  char type;
+  std::string payload;
+  if (!nextFrame(false, type, payload)) return boost::none;
+  return toResult(type, payload);
+}
+
+ControlProcessDaemon::Result ControlProcessDaemon::wait() {
+  if (!busy() || pending()) noTask();
+  char type;
+  std::string payload;
+  nextFrame(true, type, payload);
+  return toResult(type, payload);
+}
+
+void ControlProcessDaemon::start(const BatchTask &batch) {
+  BOOST_ASSERT(running());
+  BOOST_ASSERT(!busy());
+  STREAM_TRACE << "Attempt to execute batch of " << batch.tasks.size()
+               << " process groups.";
+  if (batch.tasks.empty()) return;
+  send(REQUEST_BATCH, serialization::serialize(batch));
+  pending_ = batch.tasks.size();
+}
+
+boost::optional<ControlProcessDaemon::BatchResult>
+ControlProcessDaemon::pollBatch() {
+  if (!pending()) noTask();
+  char type;
+  std::string payload;
+  if (!nextFrame(false, type, payload)) return boost::none;
+  return toBatchResult(type, payload);
+}
+
+ControlProcessDaemon::BatchResult ControlProcessDaemon::waitBatch() {
+  if (!pending()) noTask();
+  char type;
+  std::string payload;
+  nextFrame(true, type, payload);
+  return toBatchResult(type, payload);
+}
+
+void ControlProcessDaemon::stop() {
+  if (!running()) return;
+  // control process may be needed to terminate its tasks,
+  // e.g. LXC monitor, so it is killed last
+  if (terminator_) {
+    try {
+      terminator_();
+    } catch (...) {
+      ::kill(pid_, SIGKILL);
+      throw;
+    }
+  }
+  STREAM_INFO << "Killing persistent control process pid = " << pid_ << ".";
+  ::kill(pid_, SIGKILL);
+}
+
+void ControlProcessDaemon::close() {
+  if (!running()) return;
+  // control process will not notice closed socket until task is completed
+  if (busy()) stop();
+  socket_.close();
+  reap();
+}
+
+void ControlProcessDaemon::send(const char type, const std::string &payload) {
+  buffer_.clear();
+  busy_ = true;
+  try {
+    sendFrame(socket_.get(), type, payload);
+  } catch (std::exception &) {
+    fail("Unable to send request to persistent control process.");
+  }
+}
+
+bool ControlProcessDaemon::receive(const bool block) {
+  std::array<char, 64 * 1024> chunk;
+  for (;;) {
+    const ssize_t size = ::recv(socket_.get(), chunk.data(), chunk.size(),
+                                block ? 0 : MSG_DONTWAIT);
+    if (size < 0) {
+      if (errno == EINTR) continue;
+      if (!block && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+      BOOST_THROW_EXCEPTION(SystemError("recv"));
+    }
+    if (size == 0) return false;
+    buffer_.append(chunk.data(), size);
+    if (block) return true;
+  }
+}
+
+bool ControlProcessDaemon::extractFrame(char &type, std::string &payload) {
+  if (buffer_.size() < frameHeaderSize) return false;
+  const std::uint64_t size = frameSize(buffer_);
+  if (buffer_.size() < frameHeaderSize + size) return false;
+  type = buffer_[0];
+  payload = buffer_.substr(frameHeaderSize, size);
+  buffer_.erase(0, frameHeaderSize + size);
+  return true;
+}
+
+bool ControlProcessDaemon::nextFrame(const bool block, char &type,
+                                     std::string &payload) {
+  while (!extractFrame(type, payload)) {
+    const std::size_t size = buffer_.size();
+    if (!receive(block))
+      fail("Persistent control process has terminated unexpectedly.");
+    if (!block && buffer_.size() == size) return false;
+  }
+  return true;
+}
+
+ControlProcessDaemon::Result ControlProcessDaemon::toResult(
+    const char type, const std::string &payload) {
+  busy_ = false;
+  if (type == RESPONSE_ERROR) BOOST_THROW_EXCEPTION(protocolError(payload));
+  if (type != RESPONSE_RESULT)
+    fail("Unexpected response from persistent control process.");
+  try {
+    return serialization::deserialize<Result>(payload);
+  } catch (std::exception &) {
+    BOOST_THROW_EXCEPTION(
+        protocolError("Unable to parse control process result.")
+        << bunsan::enable_nested_current());
+  }
+}
+
+ControlProcessDaemon::BatchResult ControlProcessDaemon::toBatchResult(
+    const char type, const std::string &payload) {
+  if (type == RESPONSE_ERROR) {
+    // batch was aborted, no more results will be sent
+    pending_ = 0;
+    busy_ = false;
+    BOOST_THROW_EXCEPTION(protocolError(payload));
+  }
+  if (type != RESPONSE_BATCH_RESULT)
+    fail("Unexpected response from persistent control process.");
+  if (!--pending_) busy_ = false;
+  try {
+    return serialization::deserialize<BatchResult>(payload);
+  } catch (std::exception &) {
+    BOOST_THROW_EXCEPTION(
+        protocolError("Unable to parse control process result.")
+        << bunsan::enable_nested_current());
+  }
+}
+
+void ControlProcessDaemon::noTask() {
+  system::execution::Result result;
+  result.err = running() ? "There is no task to wait for."
+                         : "Persistent control process has terminated.";
+  BOOST_THROW_EXCEPTION(AsyncProcessGroupControlProcessError(result));
+}
+
+void ControlProcessDaemon::fail(const std::string &reason) {
+  STREAM_ERROR << reason;
+  socket_.close();
+  system::execution::Result result = reap();
+  result.err = reason;
+  BOOST_THROW_EXCEPTION(AsyncProcessGroupControlProcessError(result));
+}
+
+system::execution::Result ControlProcessDaemon::reap() {
+  BOOST_ASSERT(running());
+  system::execution::Result result;
+  int statLoc;
+  while (::waitpid(pid_, &statLoc, 0) < 0) {
+    if (errno != EINTR) BOOST_THROW_EXCEPTION(SystemError("waitpid"));
+  }
+  if (WIFEXITED(statLoc)) result.exitStatus = WEXITSTATUS(statLoc);
+  if (WIFSIGNALED(statLoc)) result.termSig = WTERMSIG(statLoc);
+  STREAM_INFO << "Persistent control process pid = " << pid_
+              << " has terminated.";
+  pid_ = -1;
+  busy_ = false;
+  pending_ = 0;
+  buffer_.clear();
+  return result;
+}
+
+void ControlProcessDaemon::serve(const int in, const int out) {
+  // results are written to socket of possibly terminated parent
+  ::signal(SIGPIPE, SIG_IGN);
+  char type;
+  std::string request;
+  while (readFrame(in, type, request)) {
+    if (type == REQUEST_BATCH) {
+      try {
+        AsyncProcessGroup::execute(
+            serialization::deserialize<BatchTask>(request),
+            [out](const BatchResult &result) {
+              sendFrame(out, RESPONSE_BATCH_RESULT,
+                        serialization::serialize(result));
+            });
+      } catch (std::exception &e) {
+        STREAM_ERROR << "Unable to execute batch due to \"" << e.what()
+                     << "\".";
+        // results that were not sent are lost
+        sendFrame(out, RESPONSE_ERROR, e.what());
+      }
+      continue;
+    }
+    ResponseType responseType = RESPONSE_RESULT;
+    std::string response;
+    try {
+      response = serialization::serialize(AsyncProcessGroup::execute(
+          serialization::deserialize<Task>(request)));
+    } catch (std::exception &e) {
+      STREAM_ERROR << "Unable to execute task due to \"" << e.what() << "\".";
+      responseType = RESPONSE_ERROR;
+      response = e.what();
+    }
+    sendFrame(out, responseType, response);
+  }
+}
+
+}  // namespace execution
+}  // namespace detail
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
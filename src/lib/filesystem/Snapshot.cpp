@@ -0,0 +1,154 @@
+#include <yandex/contest/invoker/filesystem/Snapshot.hpp>
+
+#include <yandex/contest/system/unistd/Operations.hpp>
+
+#include <yandex/contest/StreamLog.hpp>
+#include <yandex/contest/SystemError.hpp>
+
+#include <bunsan/filesystem/fstream.hpp>
+
+#include <boost/assert.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <set>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace filesystem {
+
+namespace {
+struct ::stat lstat(const boost::filesystem::path &path) {
+  struct ::stat status;
+  if (::lstat(path.c_str(), &status) < 0)
+    BOOST_THROW_EXCEPTION(SystemError("lstat")
+                          << Error::message(path.string()));
+  return status;
+}
+
+/// Path of file relative to root.
+boost::filesystem::path relativePath(const boost::filesystem::path &path,
+                                     const boost::filesystem::path &root) {
+  boost::filesystem::path relative;
+  auto iter = path.begin();
+  for (auto rootIter = root.begin(); rootIter != root.end(); ++rootIter) {
+    BOOST_ASSERT(iter != path.end() && *iter == *rootIter);
+    ++iter;
+  }
+  for (; iter != path.end(); ++iter) relative /= *iter;
+  return relative;
+}
+
+bool isDirectory(const struct ::stat &status) {
+  return S_ISDIR(status.st_mode);
+}
+
+bool sameAttributes(const struct ::stat &a, const struct ::stat &b) {
+  return a.st_mode == b.st_mode && a.st_uid == b.st_uid &&
+         a.st_gid == b.st_gid;
+}
+
+/*!
+ * \brief File was not modified nor replaced.
+ *
+ * Modification time may be set back by utimensat(2),
+ * change time is updated by kernel only.
+ */
+bool sameFile(const struct ::stat &a, const struct ::stat &b) {
+  return sameAttributes(a, b) && a.st_ino == b.st_ino &&
+         a.st_size == b.st_size && a.st_rdev == b.st_rdev &&
+         a.st_ctim.tv_sec == b.st_ctim.tv_sec &&
+         a.st_ctim.tv_nsec == b.st_ctim.tv_nsec;
+}
+}  // namespace
+
+Snapshot::Snapshot(const boost::filesystem::path &root,
+                   const boost::filesystem::path &storage)
+    : root_(boost::filesystem::absolute(root)),
+      storage_(boost::filesystem::absolute(storage)) {
+  STREAM_INFO << "Trying to take snapshot of " << root_ << ".";
+  boost::filesystem::create_directory(storage_);
+  for (boost::filesystem::recursive_directory_iterator i(root_), end; i != end;
+       ++i) {
+    const boost::filesystem::path path = relativePath(i->path(), root_);
+    Entry &entry = entries_[path];
+    entry.status = lstat(i->path());
+    if (S_ISLNK(entry.status.st_mode)) {
+      entry.symlinkValue = boost::filesystem::read_symlink(i->path());
+    } else if (S_ISREG(entry.status.st_mode) && entry.status.st_size) {
+      boost::filesystem::create_directories((storage_ / path).parent_path());
+      boost::filesystem::copy_file(i->path(), storage_ / path);
+    }
+  }
+  STREAM_INFO << "Snapshot of " << root_ << " was successfully taken, "
+              << entries_.size() << " entries were recorded.";
+}
+
+void Snapshot::restore() {
+  STREAM_INFO << "Trying to restore " << root_ << " from snapshot.";
+  std::set<boost::filesystem::path> actual;
+  for (boost::filesystem::recursive_directory_iterator i(root_), end; i != end;
+       ++i) {
+    const boost::filesystem::path path = relativePath(i->path(), root_);
+    const struct ::stat status = lstat(i->path());
+    const auto iter = entries_.find(path);
+    if (iter != entries_.end()) {
+      const Entry &entry = iter->second;
+      if (isDirectory(status) && isDirectory(entry.status)) {
+        if (!sameAttributes(status, entry.status)) setAttributes(path, entry);
+        actual.insert(path);
+        continue;
+      }
+      if (sameFile(status, entry.status)) {
+        actual.insert(path);
+        continue;
+      }
+    }
+    STREAM_DEBUG << "Removing " << path << ".";
+    // note: iterator does not read removed directory
+    if (isDirectory(status)) i.no_push();
+    boost::filesystem::remove_all(i->path());
+  }
+  for (auto &pathEntry : entries_) {
+    if (!actual.count(pathEntry.first))
+      create(pathEntry.first, pathEntry.second);
+  }
+  STREAM_INFO << root_ << " was successfully restored from snapshot.";
+}
+
+void Snapshot::create(const boost::filesystem::path &path, Entry &entry) {
+  STREAM_DEBUG << "Restoring " << path << ".";
+  const boost::filesystem::path abs = root_ / path;
+  const mode_t mode = entry.status.st_mode;
+  if (S_ISDIR(mode)) {
+    system::unistd::mkdir(abs, mode & 07777);
+  } else if (S_ISLNK(mode)) {
+    system::unistd::symlink(entry.symlinkValue, abs);
+  } else if (S_ISREG(mode)) {
+    if (entry.status.st_size) {
+      boost::filesystem::copy_file(storage_ / path, abs);
+    } else {
+      bunsan::filesystem::ofstream touch(abs);
+      touch.close();
+    }
+  } else {
+    system::unistd::mknod(abs, mode, entry.status.st_rdev);
+  }
+  setAttributes(path, entry);
+  // inode and timestamps have changed
+  entry.status = lstat(abs);
+}
+
+void Snapshot::setAttributes(const boost::filesystem::path &path,
+                             const Entry &entry) {
+  const boost::filesystem::path abs = root_ / path;
+  system::unistd::lchown(abs, {entry.status.st_uid, entry.status.st_gid});
+  // symbolic link permissions are not used
+  if (!S_ISLNK(entry.status.st_mode))
+    system::unistd::chmod(abs, entry.status.st_mode & 07777);
+}
+
+}  // namespace filesystem
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
@@ -1,7 +1,10 @@
 #include <yandex/contest/invoker/lxc/Lxc.hpp>
 
+#include <yandex/contest/invoker/detail/CloseDescriptors.hpp>
+
 #include <yandex/contest/system/execution/ErrCall.hpp>
 #include <yandex/contest/system/unistd/Fstab.hpp>
+#include <yandex/contest/system/unistd/Operations.hpp>
 
 #include <yandex/contest/StreamLog.hpp>
 
@@ -9,11 +12,16 @@
 
 #include <bunsan/filesystem/fstream.hpp>
 
+#include <boost/assert.hpp>
 #include <boost/filesystem/operations.hpp>
 
 #include <chrono>
+#include <string>
 #include <thread>
 
+#include <sys/wait.h>
+#include <unistd.h>
+
 namespace yandex {
 namespace contest {
 namespace invoker {
@@ -23,14 +31,20 @@ using system::execution::ProcessArguments;
 namespace unistd = system::unistd;
 
 Lxc::Lxc(const std::string &name, const boost::filesystem::path &dir,
-         const Config &config)
+         const Config &config, const Backend backend,
+         const std::chrono::seconds stopTimeout)
     : name_(name),
       dir_(boost::filesystem::absolute(dir)),
       rootfs_(dir_ / "rootfs"),
       rootfsMount_(dir_ / "rootfs.mount"),
       configPath_(dir_ / "config"),
-      container_(api::container_new(name_)),
-      lastStart_(Clock::now()) {
+      backend_(backend),
+      stopTimeout_(stopTimeout),
+      // sandbox does not need LXC
+      container_(backend_ == Backend::SANDBOX ? nullptr
+                                              : api::container_new(name_)),
+      lastStart_(Clock::now()),
+      starting_(false) {
   STREAM_INFO << "Trying to create \"" << name_ << "\" LXC.";
   Config config_ = config;
   prepare(config_);
@@ -59,12 +73,34 @@ Lxc::Lxc(const std::string &name, const boost::filesystem::path &dir,
   }
   STREAM_DEBUG << "Loading LXC config for \"" << name_ << "\" at "
                << configPath_;
+  if (backend_ == Backend::SANDBOX) {
+    sandbox_.reset(new Sandbox(name_, config_));
+    return;
+  }
   if (!container_->load_config(container_.get(), configPath_.string().c_str()))
     BOOST_THROW_EXCEPTION(Error());
 }
 
+Backend Lxc::backend() const { return backend_; }
+
 void Lxc::freeze() {
   STREAM_INFO << "Trying to freeze \"" << name_ << "\" LXC.";
+  if (backend_ == Backend::SANDBOX) {
+    sandbox_->freeze();
+    STREAM_INFO << "\"" << name_ << "\" LXC was successfully frozen.";
+    return;
+  }
+  if (backend_ == Backend::API) {
+    if (!container_->freeze(container_.get())) {
+      STREAM_ERROR << "Error while freezing \"" << name_ << "\" LXC, "
+                   << "exception is thrown.";
+      BOOST_THROW_EXCEPTION(ApiError() << Error::name(name_)
+                                       << Error::message(
+                                              "Error while freezing LXC."));
+    }
+    STREAM_INFO << "\"" << name_ << "\" LXC was successfully frozen.";
+    return;
+  }
   const system::execution::Result result =
       system::execution::getErrCallArgv("lxc-freeze", "-n", name_);
   if (result) {
@@ -79,6 +115,24 @@ void Lxc::freeze() {
 
 void Lxc::unfreeze() {
   STREAM_INFO << "Trying to unfreeze \"" << name_ << "\" LXC.";
+  if (backend_ == Backend::SANDBOX) {
+    sandbox_->unfreeze();
+    STREAM_INFO << "\"" << name_ << "\" LXC "
+                << "was successfully unfrozen.";
+    return;
+  }
+  if (backend_ == Backend::API) {
+    if (!container_->unfreeze(container_.get())) {
+      STREAM_ERROR << "Error while unfreezing \"" << name_ << "\" LXC, "
+                   << "exception is thrown.";
+      BOOST_THROW_EXCEPTION(ApiError() << Error::name(name_)
+                                       << Error::message(
+                                              "Error while unfreezing LXC."));
+    }
+    STREAM_INFO << "\"" << name_ << "\" LXC "
+                << "was successfully unfrozen.";
+    return;
+  }
   const system::execution::Result result =
       system::execution::getErrCallArgv("lxc-unfreeze", "-n", name_);
   if (result) {
@@ -92,13 +146,8 @@ void Lxc::unfreeze() {
   }
 }
 
-void Lxc::execute_(const Executor &executor,
-                   const system::execution::AsyncProcess::Options &options) {
+void Lxc::beforeStart() {
   lastStart_ = Clock::now();
-  // TODO thread-safety
-  // TODO lxc-execute errors control
-  STREAM_INFO << "Attempt to execute command "
-              << "in \"" << name_ << "\" LXC.";
   // we need to use it twice
   // and do not want it to change
   const State state_ = state();
@@ -111,11 +160,96 @@ void Lxc::execute_(const Executor &executor,
         << IllegalStateError::state(state_)
         << Error::message("It is impossible to spawn process in LXC."));
   }
+  // sandbox is started synchronously
+  starting_ = backend_ != Backend::SANDBOX;
+}
+
+void Lxc::execute_(const Executor &executor,
+                   const system::execution::AsyncProcess::Options &options) {
+  // TODO thread-safety
+  // TODO lxc-execute errors control
+  STREAM_INFO << "Attempt to execute command "
+              << "in \"" << name_ << "\" LXC.";
+  beforeStart();
   executor(transform(options));
   STREAM_INFO << "Command execution is started "
               << "in \"" << name_ << "\" LXC.";
 }
 
+pid_t Lxc::start(const ProcessArguments &arguments,
+                 const std::function<void()> &setUp) {
+  BOOST_ASSERT(!arguments.empty());
+  STREAM_INFO << "Attempt to start application "
+              << "in \"" << name_ << "\" LXC.";
+  beforeStart();
+  if (backend_ == Backend::SANDBOX) return sandbox_->start(arguments, setUp);
+  // prepared before fork(), child should not allocate
+  // until liblxc takes over
+  std::vector<char *> argv;
+  for (const std::string &arg : arguments)
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  argv.push_back(nullptr);
+  ::lxc_container *const c = container_.get();
+  c->want_daemonize(c, false);
+  // standard streams set up by setUp() should be inherited,
+  // other descriptors are closed by the child itself:
+  // it stays alive as container's monitor
+  c->want_close_all_fds(c, false);
+  const unsigned maxFd = unistd::getdtablesize();
+  const pid_t pid = unistd::fork();
+  if (pid == 0) {
+    try {
+      setUp();
+    } catch (...) {
+      ::_exit(1);
+    }
+    // descriptors of other containers, e.g. control process sockets
+    // and core locks, should not outlive them
+    if (!detail::closeDescriptors(-1, maxFd)) ::_exit(1);
+    // lxc_container::start() returns when container is stopped
+    if (!c->start(c, 1, argv.data())) ::_exit(1);
+    ::_exit(WIFEXITED(c->error_num) ? WEXITSTATUS(c->error_num) : 1);
+  }
+  STREAM_INFO << "Application was started in \"" << name_ << "\" LXC, "
+              << "pid = " << pid << ".";
+  return pid;
+}
+
+bool Lxc::tryStop() {
+  if (backend_ == Backend::SANDBOX) return sandbox_->stop();
+  if (backend_ == Backend::API) {
+    if (!container_->is_running(container_.get())) return false;
+    if (!container_->stop(container_.get())) {
+      STREAM_ERROR << "Error while stopping \"" << name_ << "\" LXC, "
+                   << "exception is thrown.";
+      BOOST_THROW_EXCEPTION(ApiError() << Error::name(name_)
+                                       << Error::message(
+                                              "Error while stopping LXC."));
+    }
+    return true;
+  }
+  const system::execution::Result result =
+      system::execution::getErrCallArgv("lxc-stop", "-n", name_, "--kill");
+  if (result) return true;
+  if (result.exitStatus && *result.exitStatus == 2) return false;
+  STREAM_ERROR << "Error while stopping \"" << name_ << "\" LXC: \""
+               << result.err << "\", "
+               << "exception is thrown.";
+  BOOST_THROW_EXCEPTION(toUtilityError(result)
+                        << Error::message("Error while stopping LXC."));
+}
+
+bool Lxc::wait(const std::string &states,
+               const std::chrono::seconds timeout) {
+  if (backend_ == Backend::SANDBOX) {
+    // sandbox is running as soon as it is started
+    BOOST_ASSERT(states == "STOPPED");
+    return sandbox_->wait(timeout);
+  }
+  // container is loaded for UTILITY backend too, lxc-wait(1) is not needed
+  return container_->wait(container_.get(), states.c_str(), timeout.count());
+}
+
 void Lxc::stop() {
   STREAM_INFO << "Trying to stop \"" << name_ << "\" LXC.";
   const State state_ = state();
@@ -124,43 +258,53 @@ void Lxc::stop() {
                 << "it should be unfrozen first.";
     unfreeze();
   }
-  const auto end = lastStart_.load() + std::chrono::milliseconds(200);
-  const auto step = std::chrono::milliseconds(25);
-  do {
-    const system::execution::Result result =
-        system::execution::getErrCallArgv("lxc-stop", "-n", name_, "--kill");
-    if (result) {
-      STREAM_INFO << "\"" << name_ << "\" LXC was successfully stopped.";
+  // lxc-execute may have not reached the container start yet,
+  // container that has already completed is never seen running,
+  // so waiting for start is short and is not done by wait()
+  constexpr std::chrono::milliseconds startTimeout(200);
+  constexpr std::chrono::milliseconds startStep(25);
+  while (!tryStop()) {
+    if (!starting_ || Clock::now() >= lastStart_.load() + startTimeout) {
+      starting_ = false;
+      STREAM_INFO << "\"" << name_ << "\" LXC is not running.";
       return;
-    } else if (result.exitStatus && *result.exitStatus == 2) {
-      STREAM_DEBUG << "\"" << name_
-                   << "\" LXC is not running, nothing to be stopped. "
-                   << "Sleeping to allow not-started LXC to start...";
-      std::this_thread::sleep_for(step);
-    } else {
-      STREAM_ERROR << "Error while stopping \"" << name_ << "\" LXC: \""
-                   << result.err << "\", "
-                   << "exception is thrown.";
-      BOOST_THROW_EXCEPTION(toUtilityError(result)
-                            << Error::message("Error while stopping LXC."));
     }
-  } while (Clock::now() < end);
-  STREAM_INFO << "\"" << name_ << "\" LXC is not running.";
+    STREAM_DEBUG << "\"" << name_ << "\" LXC is not running yet, "
+                 << "waiting for it to start...";
+    std::this_thread::sleep_for(startStep);
+  }
+  starting_ = false;
+  if (!wait("STOPPED", stopTimeout_)) {
+    STREAM_ERROR << "\"" << name_ << "\" LXC was not stopped in time, "
+                 << "exception is thrown.";
+    BOOST_THROW_EXCEPTION(
+        IllegalStateError() << IllegalStateError::state(state())
+                            << Error::name(name_)
+                            << Error::message("Unable to stop LXC."));
+  }
+  STREAM_INFO << "\"" << name_ << "\" LXC was successfully stopped.";
 }
 
 Lxc::State Lxc::state() {
+  if (backend_ == Backend::SANDBOX) return sandbox_->state();
   const char *const st = container_->state(container_.get());
-  return boost::lexical_cast<State>(st);
+  const State state_ = boost::lexical_cast<State>(st);
+  if (state_ != State::STOPPED) starting_ = false;
+  return state_;
 }
 
 Lxc::~Lxc() {
   STREAM_INFO << "Trying to remove \"" << name_ << "\" LXC.";
+  // nothing can start container at this point
+  starting_ = false;
   try {
     stop();
   } catch (std::exception &) {
     STREAM_ERROR << "Unable to stop \"" << name_ << "\" LXC (ignoring).";
   }
-  container_.reset();  // after stop && before remove
+  // after stop && before remove
+  sandbox_.reset();
+  container_.reset();
   boost::system::error_code ec;
   boost::filesystem::remove_all(dir_, ec);
   if (ec)
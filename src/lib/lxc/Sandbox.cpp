@@ -0,0 +1,370 @@
+#include <yandex/contest/invoker/lxc/Sandbox.hpp>
+
+#include <yandex/contest/invoker/detail/CloseDescriptors.hpp>
+#include <yandex/contest/invoker/lxc/Error.hpp>
+
+#include <yandex/contest/system/unistd/Fstab.hpp>
+#include <yandex/contest/system/unistd/Operations.hpp>
+
+#include <yandex/contest/StreamLog.hpp>
+#include <yandex/contest/SystemError.hpp>
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/join.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include <cerrno>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <linux/capability.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mount.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace yandex {
+namespace contest {
+namespace invoker {
+namespace lxc {
+
+namespace {
+/// Indexed by capability number, see capabilities(7).
+const char *const capabilityNames[] = {
+    "chown",           "dac_override",     "dac_read_search",
+    "fowner",          "fsetid",           "kill",
+    "setgid",          "setuid",           "setpcap",
+    "linux_immutable", "net_bind_service", "net_broadcast",
+    "net_admin",       "net_raw",          "ipc_lock",
+    "ipc_owner",       "sys_module",       "sys_rawio",
+    "sys_chroot",      "sys_ptrace",       "sys_pacct",
+    "sys_admin",       "sys_boot",         "sys_nice",
+    "sys_resource",    "sys_time",         "sys_tty_config",
+    "mknod",           "lease",            "audit_write",
+    "audit_control",   "setfcap",          "mac_override",
+    "mac_admin",       "syslog",           "wake_alarm",
+    "block_suspend",   "audit_read",       "perfmon",
+    "bpf",             "checkpoint_restore"};
+
+int capability(const std::string &name) {
+  const std::string name_ = boost::algorithm::to_lower_copy(name);
+  const auto begin = std::begin(capabilityNames),
+             end = std::end(capabilityNames);
+  const auto iter = std::find(begin, end, name_);
+  if (iter == end)
+    BOOST_THROW_EXCEPTION(ConfigError()
+                          << ConfigError::key("cap.drop")
+                          << ConfigError::line(name)
+                          << Error::message("Unknown capability."));
+  return iter - begin;
+}
+
+/*
+ * Functions below are called in forked child of possibly
+ * multithreaded process, they do not allocate and do not throw.
+ */
+
+/*!
+ * \brief Remove from bounding, effective, permitted and inheritable sets.
+ *
+ * \return false on failure.
+ */
+bool dropCapabilities(const std::vector<int> &capabilities) noexcept {
+  if (capabilities.empty()) return true;
+  for (const int cap : capabilities) {
+    // capability unknown to running kernel can't be granted anyway
+    if (::prctl(PR_CAPBSET_DROP, cap, 0, 0, 0) < 0 && errno != EINVAL)
+      return false;
+  }
+  ::__user_cap_header_struct header = {_LINUX_CAPABILITY_VERSION_3, 0};
+  ::__user_cap_data_struct data[_LINUX_CAPABILITY_U32S_3];
+  if (::syscall(SYS_capget, &header, data) < 0) return false;
+  for (const int cap : capabilities) {
+    const std::uint32_t mask = ~(std::uint32_t(1) << (cap % 32));
+    data[cap / 32].effective &= mask;
+    data[cap / 32].permitted &= mask;
+    data[cap / 32].inheritable &= mask;
+  }
+  return ::syscall(SYS_capset, &header, data) == 0;
+}
+
+/// Arguments of mount(2).
+struct MountCall {
+  std::string source;
+  boost::filesystem::path target;
+  std::string type;
+  unsigned long flags;
+  std::string data;
+};
+
+bool mount(const MountCall &call) noexcept {
+  return ::mount(call.source.empty() ? nullptr : call.source.c_str(),
+                 call.target.c_str(),
+                 call.type.empty() ? nullptr : call.type.c_str(), call.flags,
+                 call.data.empty() ? nullptr : call.data.c_str()) == 0;
+}
+
+/// Mount fstab(5) entry, LXC-specific options are ignored.
+void appendMountCalls(std::vector<MountCall> &calls,
+                      const system::unistd::MountEntry &entry) {
+  std::vector<std::string> opts, data;
+  boost::algorithm::split(opts, entry.opts, boost::algorithm::is_any_of(","));
+  unsigned long flags = 0;
+  for (const std::string &opt : opts) {
+    if (opt.empty() || opt == "defaults" || opt == "rw" ||
+        opt == "optional" || boost::algorithm::starts_with(opt, "create="))
+      continue;
+    if (opt == "ro")
+      flags |= MS_RDONLY;
+    else if (opt == "nosuid")
+      flags |= MS_NOSUID;
+    else if (opt == "nodev")
+      flags |= MS_NODEV;
+    else if (opt == "noexec")
+      flags |= MS_NOEXEC;
+    else if (opt == "bind")
+      flags |= MS_BIND;
+    else if (opt == "rbind")
+      flags |= MS_BIND | MS_REC;
+    else
+      data.push_back(opt);
+  }
+  const std::string data_ = boost::algorithm::join(data, ",");
+  if (flags & MS_BIND) {
+    // bind mount ignores other flags, they are applied by remount
+    calls.push_back(
+        {entry.fsname, entry.dir, "", flags & (MS_BIND | MS_REC), ""});
+    if (flags & ~(MS_BIND | MS_REC))
+      calls.push_back({"", entry.dir, "", flags | MS_REMOUNT, ""});
+  } else {
+    calls.push_back({entry.fsname, entry.dir, entry.type, flags, data_});
+  }
+}
+
+/// Mounts of container's mount namespace in order.
+std::vector<MountCall> mountCalls(const Config &config) {
+  std::vector<MountCall> calls;
+  // do not propagate anything to parent namespace
+  calls.push_back({"", "/", "", MS_REC | MS_PRIVATE, ""});
+  if (config.mount) {
+    if (config.mount->fstab) {
+      system::unistd::Fstab fstab;
+      fstab.load(config.mount->fstab.get());
+      for (const system::unistd::MountEntry &entry : fstab)
+        appendMountCalls(calls, entry);
+    }
+    if (config.mount->entries)
+      for (const system::unistd::MountEntry &entry :
+           config.mount->entries.get())
+        appendMountCalls(calls, entry);
+  }
+  // mount entries are inside rootfs, so they are moved with it
+  calls.push_back({config.rootfs->fsname->string(), config.rootfs->mount.get(),
+                   "", MS_BIND | MS_REC, ""});
+  return calls;
+}
+
+/*!
+ * \brief Mount everything and change root.
+ *
+ * \return false on failure.
+ */
+bool setUpFilesystem(const std::vector<MountCall> &calls,
+                     const boost::filesystem::path &newRoot) noexcept {
+  for (const MountCall &call : calls)
+    if (!mount(call)) return false;
+  if (::chdir(newRoot.c_str()) < 0) return false;
+  // old root is stacked under new one and detached
+  if (::syscall(SYS_pivot_root, ".", ".") < 0) return false;
+  if (::umount2(".", MNT_DETACH) < 0) return false;
+  return ::chdir("/") == 0;
+}
+
+/// Exit status of shell for terminated child.
+int exitStatus(const int statLoc) {
+  return WIFEXITED(statLoc) ? WEXITSTATUS(statLoc) : 128 + WTERMSIG(statLoc);
+}
+}  // namespace
+
+Sandbox::Sandbox(const std::string &name, const Config &config)
+    : name_(name), config_(config), controlGroup_("sandbox_" + name) {
+  BOOST_ASSERT(config_.rootfs);
+  BOOST_ASSERT(config_.rootfs->fsname);
+  BOOST_ASSERT(config_.rootfs->mount);
+  if (config_.network) {
+    for (const NetworkConfigEntry &entry : config_.network.get()) {
+      if (entry.type != "empty")
+        BOOST_THROW_EXCEPTION(
+            ConfigError() << ConfigError::key("network.type")
+                          << ConfigError::line(entry.type)
+                          << Error::name(name_)
+                          << Error::message(
+                                 "Sandbox network namespace is empty."));
+    }
+  }
+  if (config_.console && config_.console.get() != "none")
+    BOOST_THROW_EXCEPTION(
+        ConfigError() << ConfigError::key("console")
+                      << ConfigError::line(config_.console->string())
+                      << Error::name(name_)
+                      << Error::message("Sandbox has no console."));
+  if (config_.cap_drop)
+    for (const std::string &cap : config_.cap_drop.get())
+      capDrop_.push_back(capability(cap));
+  if (config_.cgroup)
+    for (const auto &field : config_.cgroup.get())
+      controlGroup_.writeField(field.first, field.second);
+  STREAM_INFO << "Control group was successfully created for \"" << name_
+              << "\" sandbox: " << controlGroup_ << ".";
+}
+
+Sandbox::~Sandbox() {
+  try {
+    if (stop()) wait(std::chrono::seconds(1));
+    // control group is removed on destruction
+    controlGroup_.terminate();
+  } catch (std::exception &e) {
+    STREAM_ERROR << "Unable to remove \"" << name_ << "\" sandbox due to \""
+                 << e.what() << "\" (ignoring).";
+  }
+}
+
+pid_t Sandbox::start(const system::execution::ProcessArguments &arguments,
+                     const std::function<void()> &setUp) {
+  BOOST_ASSERT(!arguments.empty());
+  BOOST_ASSERT(!running());
+  // prepared before fork(), child should not allocate
+  std::vector<char *> argv;
+  for (const std::string &arg : arguments)
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  argv.push_back(nullptr);
+  const std::vector<MountCall> mounts = mountCalls(config_);
+  const boost::filesystem::path &newRoot = config_.rootfs->mount.get();
+  std::vector<system::unistd::Descriptor> attachFds;
+  for (const boost::filesystem::path &attachFile : controlGroup_.attachFiles())
+    attachFds.push_back(
+        system::unistd::open(attachFile, O_WRONLY | O_CLOEXEC));
+  // the only descriptor supervisor keeps, see running()
+  int exitFds[2];
+  if (::pipe2(exitFds, O_CLOEXEC) < 0)
+    BOOST_THROW_EXCEPTION(SystemError("pipe2"));
+  system::unistd::Descriptor exitFd(exitFds[0]), exitWriteFd(exitFds[1]);
+  const unsigned maxFd = system::unistd::getdtablesize();
+  // supervisor: joins control group and creates namespaces,
+  // its first child is init of new pid namespace
+  const pid_t pid = system::unistd::fork();
+  if (pid == 0) {
+    for (const system::unistd::Descriptor &attachFd : attachFds) {
+      if (::write(attachFd.get(), "0", 1) != 1) ::_exit(1);
+    }
+    try {
+      setUp();
+    } catch (...) {
+      ::_exit(1);
+    }
+    // descriptors of other containers, e.g. control process sockets
+    // and core locks, should not outlive them
+    if (!detail::closeDescriptors(exitWriteFd.get(), maxFd)) ::_exit(1);
+    if (::unshare(CLONE_NEWNS | CLONE_NEWPID | CLONE_NEWUTS | CLONE_NEWIPC |
+                  CLONE_NEWNET) < 0)
+      ::_exit(1);
+    const pid_t init = ::fork();
+    if (init < 0) ::_exit(1);
+    if (init == 0) {
+      ::close(exitWriteFd.get());
+      // container terminates with its supervisor
+      if (::prctl(PR_SET_PDEATHSIG, SIGKILL, 0, 0, 0) < 0) ::_exit(1);
+      if (!setUpFilesystem(mounts, newRoot)) ::_exit(1);
+      if (config_.utsname &&
+          ::sethostname(config_.utsname->c_str(), config_.utsname->size()) <
+              0)
+        ::_exit(1);
+      if (!dropCapabilities(capDrop_)) ::_exit(1);
+      const pid_t application = ::fork();
+      if (application < 0) ::_exit(1);
+      if (application == 0) {
+        ::execvp(argv[0], argv.data());
+        ::_exit(1);
+      }
+      // act as init: reap orphans until application terminates
+      int statLoc;
+      for (;;) {
+        const pid_t child = ::wait(&statLoc);
+        if (child < 0 && errno != EINTR) ::_exit(1);
+        if (child == application) break;
+      }
+      ::_exit(exitStatus(statLoc));
+    }
+    int statLoc;
+    while (::waitpid(init, &statLoc, 0) < 0) {
+      if (errno != EINTR) ::_exit(1);
+    }
+    ::_exit(exitStatus(statLoc));
+  }
+  pid_ = pid;
+  exitFd_ = std::move(exitFd);
+  frozen_ = false;
+  STREAM_INFO << "\"" << name_ << "\" sandbox was started, "
+              << "supervisor pid = " << pid << ".";
+  return pid;
+}
+
+Sandbox::State Sandbox::state() const {
+  if (!running()) return State::STOPPED;
+  return frozen_ ? State::FROZEN : State::RUNNING;
+}
+
+void Sandbox::freeze() {
+  controlGroup_.freeze();
+  frozen_ = true;
+}
+
+void Sandbox::unfreeze() {
+  controlGroup_.unfreeze();
+  frozen_ = false;
+}
+
+bool Sandbox::stop() {
+  if (!running()) return false;
+  // supervisor has not exited, so it is not reaped and pid is not reused;
+  // it may have not joined control group yet
+  if (::kill(pid_, SIGKILL) < 0 && errno != ESRCH)
+    BOOST_THROW_EXCEPTION(SystemError("kill"));
+  if (frozen_) unfreeze();
+  controlGroup_.terminate();
+  return true;
+}
+
+bool Sandbox::wait(const std::chrono::milliseconds timeout) const {
+  if (!exitFd_) return true;
+  // write end is closed by supervisor's exit only
+  ::pollfd fd = {exitFd_.get(), POLLIN, 0};
+  for (;;) {
+    const int ready = ::poll(&fd, 1, timeout.count());
+    if (ready < 0) {
+      if (errno == EINTR) continue;
+      BOOST_THROW_EXCEPTION(SystemError("poll"));
+    }
+    return ready > 0;
+  }
+}
+
+bool Sandbox::running() const {
+  return !wait(std::chrono::milliseconds(0));
+}
+
+}  // namespace lxc
+}  // namespace invoker
+}  // namespace contest
+}  // namespace yandex
@@ -24,6 +24,37 @@ BOOST_AUTO_TEST_CASE(true_) {
   verifyPRExit(1);
 }
 
+BOOST_AUTO_TEST_CASE(parallel_start) {
+  task.parallelStart = true;
+  p0.executable = "echo";
+  p0.arguments = {"echo", "arbitrary text"};
+  p1.executable = "sh";
+  p1.arguments = {"sh", "-ce",
+                  "read text; test \"arbitrary text\" = \"$text\""};
+  p0.descriptors[1] = pipe(0).writeEnd();
+  p1.descriptors[0] = pipe(0).readEnd();
+  run();
+  verifyPGR();
+  verifyPRExit(0);
+  verifyPRExit(1);
+}
+
+BOOST_AUTO_TEST_CASE(idle_only_if_group_is_idle) {
+  task.resourceLimits.idleOnlyIfGroupIsIdle = true;
+  // waits for busy process, so it is not idle
+  p0.executable = "sh";
+  p0.arguments = {"sh", "-ce", "read text"};
+  p0.resourceLimits.idleTimeLimit = sleepTime;
+  p1.executable = "perl";
+  p1.arguments = {"perl", "-e", "1 while (times)[0] < 1; print \"\\n\""};
+  p0.descriptors[0] = pipe(0).readEnd();
+  p1.descriptors[1] = pipe(0).writeEnd();
+  run();
+  verifyPGR();
+  verifyPRExit(0);
+  verifyPRExit(1);
+}
+
 BOOST_AUTO_TEST_SUITE(fast_slow)
 
 BOOST_AUTO_TEST_CASE(fast_not_ok) {
@@ -7,14 +7,40 @@
 #include <bunsan/test/filesystem/read_data.hpp>
 #include <bunsan/test/filesystem/tempdir.hpp>
 
+#include <bunsan/filesystem/fstream.hpp>
+
 #include <boost/filesystem/operations.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <iterator>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
 #include <cerrno>
 #include <csignal>
 
 using namespace bunsan::test;
 
+namespace {
+/// Whether cgroup v2 io controller is enabled.
+bool ioControllerAvailable() {
+  const boost::filesystem::path controllers =
+      "/sys/fs/cgroup/cgroup.controllers";
+  if (!boost::filesystem::exists(controllers)) return false;
+  bunsan::filesystem::ifstream fin(controllers);
+  std::set<std::string> names;
+  BUNSAN_FILESYSTEM_FSTREAM_WRAP_BEGIN(fin) {
+    names.insert(std::istream_iterator<std::string>(fin),
+                 std::istream_iterator<std::string>());
+  } BUNSAN_FILESYSTEM_FSTREAM_WRAP_END(fin)
+  fin.close();
+  return names.count("io");
+}
+}  // namespace
+
 BOOST_FIXTURE_TEST_SUITE(single, AsyncProcessGroupSingleFixture)
 
 BOOST_AUTO_TEST_CASE(true_) {
@@ -73,6 +99,69 @@ BOOST_AUTO_TEST_SUITE(resource_usage)
 
 // TODO
 
+BOOST_AUTO_TEST_CASE(stall_time) {
+  process.executable = "sleep";
+  process.arguments = {"sleep", sleepTimeStr};
+  run();
+  verifyPGR();
+  verifyPRExit(0);
+  const auto &resourceUsage = pr(0).resourceUsage;
+  if (!resourceUsage.cpuSomeStallTime) {
+    BOOST_TEST_MESSAGE("Pressure stall information is not available.");
+    return;
+  }
+  // sleeping process is idle, not stalled
+  BOOST_CHECK(resourceUsage.cpuSomeStallTime.get() < sleepTime);
+  BOOST_REQUIRE(resourceUsage.memorySomeStallTime);
+  BOOST_REQUIRE(resourceUsage.memoryFullStallTime);
+  BOOST_CHECK(resourceUsage.memoryFullStallTime.get() <=
+              resourceUsage.memorySomeStallTime.get());
+}
+
+BOOST_AUTO_TEST_CASE(io_usage) {
+  if (!ioControllerAvailable()) {
+    BOOST_TEST_MESSAGE("I/O controller is not available.");
+    return;
+  }
+  process.executable = "/usr/bin/env";
+  TMP tmpfile;
+  // fsync makes writeback happen before process exits
+  process.arguments = {"env", "dd", "if=/dev/zero",
+                       "of=" + tmpfile.path().string(), "bs=1M", "count=4",
+                       "conv=fsync"};
+  process.resourceLimits.outputLimitBytes = 8 * 1024 * 1024;
+  run();
+  verifyPGR();
+  verifyPRExit(0);
+  const auto &resourceUsage = pr(0).resourceUsage;
+  BOOST_REQUIRE(resourceUsage.ioWriteBytes);
+  BOOST_REQUIRE(resourceUsage.ioWriteOperations);
+  if (!resourceUsage.ioWriteBytes.get()) {
+    BOOST_TEST_MESSAGE("Temporary file is not on a block device.");
+    return;
+  }
+  BOOST_CHECK_GE(resourceUsage.ioWriteBytes.get(), 4 * 1024 * 1024);
+  BOOST_CHECK_GT(resourceUsage.ioWriteOperations.get(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(io_usage_output_limit) {
+  if (!ioControllerAvailable()) {
+    BOOST_TEST_MESSAGE("I/O controller is not available.");
+    return;
+  }
+  process.executable = "/usr/bin/env";
+  TMP tmpfile;
+  process.arguments = {"env", "dd", "if=/dev/zero",
+                       "of=" + tmpfile.path().string(), "bs=1M", "count=4"};
+  process.resourceLimits.outputLimitBytes = 1024 * 1024;
+  run();
+  verifyPGR(PGR::CompletionStatus::ABNORMAL_EXIT);
+  verifyPR(0, PR::CompletionStatus::OUTPUT_LIMIT_EXCEEDED);
+  // collected for every completion status
+  BOOST_CHECK(pr(0).resourceUsage.ioReadBytes);
+  BOOST_CHECK(pr(0).resourceUsage.ioWriteBytes);
+}
+
 BOOST_AUTO_TEST_SUITE_END()  // resource_usage
 
 BOOST_AUTO_TEST_SUITE(resource_limits)
@@ -85,6 +174,55 @@ BOOST_AUTO_TEST_CASE(real_time_limit) {
   verifyPGR(PGR::CompletionStatus::REAL_TIME_LIMIT_EXCEEDED);
 }
 
+BOOST_AUTO_TEST_CASE(process_real_time_limit) {
+  process.executable = "sleep";
+  process.arguments = {"sleep", decaSleepTimeStr};
+  task.resourceLimits.realTimeLimit = 10 * decaSleepTime;
+  process.resourceLimits.realTimeLimit = sleepTime;
+  run();
+  verifyPGR(PGR::CompletionStatus::ABNORMAL_EXIT);
+  verifyPR(0, PR::CompletionStatus::REAL_TIME_LIMIT_EXCEEDED);
+  BOOST_CHECK(pr(0).resourceUsage.realTimeUsage >= sleepTime);
+  BOOST_CHECK(pr(0).resourceUsage.realTimeUsage < decaSleepTime);
+}
+
+BOOST_AUTO_TEST_CASE(idle_time_limit) {
+  process.executable = "sleep";
+  process.arguments = {"sleep", decaSleepTimeStr};
+  task.resourceLimits.realTimeLimit = 10 * decaSleepTime;
+  process.resourceLimits.idleTimeLimit = sleepTime;
+  run();
+  verifyPGR(PGR::CompletionStatus::ABNORMAL_EXIT);
+  verifyPR(0, PR::CompletionStatus::IDLE_TIME_LIMIT_EXCEEDED);
+  BOOST_CHECK(pr(0).resourceUsage.realTimeUsage < decaSleepTime);
+}
+
+BOOST_AUTO_TEST_CASE(io_write_limit) {
+  if (!ioControllerAvailable()) {
+    BOOST_TEST_MESSAGE("I/O controller is not available.");
+    return;
+  }
+  process.executable = "/usr/bin/env";
+  TMP tmpfile;
+  // throttled writeback is waited for by fsync
+  process.arguments = {"env", "dd", "if=/dev/zero",
+                       "of=" + tmpfile.path().string(), "bs=1M", "count=3",
+                       "conv=fsync"};
+  process.resourceLimits.outputLimitBytes = 8 * 1024 * 1024;
+  process.resourceLimits.ioWriteBytesPerSecond = 1024 * 1024;
+  task.resourceLimits.realTimeLimit = 10 * decaSleepTime;
+  run();
+  verifyPGR();
+  verifyPRExit(0);
+  const auto &resourceUsage = pr(0).resourceUsage;
+  BOOST_REQUIRE(resourceUsage.ioWriteBytes);
+  if (!resourceUsage.ioWriteBytes.get()) {
+    BOOST_TEST_MESSAGE("Temporary file is not on a block device.");
+    return;
+  }
+  BOOST_CHECK(resourceUsage.realTimeUsage >= std::chrono::seconds(1));
+}
+
 BOOST_AUTO_TEST_SUITE(cpu_limit)
 
 BOOST_AUTO_TEST_CASE(busy_beaver) {
@@ -107,6 +245,29 @@ BOOST_AUTO_TEST_CASE(busy_beaver) {
   verifyPR(0, PR::CompletionStatus::USER_TIME_LIMIT_EXCEEDED);
 }
 
+BOOST_AUTO_TEST_CASE(instruction_limit) {
+  process.executable = "true";
+  process.resourceLimits.countHardwareEvents = true;
+  run();
+  verifyPGR();
+  verifyPRExit(0);
+  if (!pr(0).resourceUsage.instructions) {
+    BOOST_TEST_MESSAGE("Hardware events are not supported.");
+    return;
+  }
+  BOOST_CHECK_GT(pr(0).resourceUsage.instructions.get(), 0);
+
+  process.executable = "perl";
+  // busy beaver
+  process.arguments = {"perl", "-e", "while (true) {}"};
+  task.resourceLimits.realTimeLimit = 10 * decaSleepTime;
+  process.resourceLimits.timeLimit = 10 * decaSleepTime;
+  process.resourceLimits.instructionLimit = 100 * 1000 * 1000;
+  run();
+  verifyPGR(PGR::CompletionStatus::ABNORMAL_EXIT);
+  verifyPR(0, PR::CompletionStatus::INSTRUCTION_LIMIT_EXCEEDED);
+}
+
 // TODO deprecated test
 BOOST_AUTO_TEST_CASE(unstable) {
   process.executable = "perl";
@@ -279,6 +440,65 @@ BOOST_AUTO_TEST_CASE(start_failed) {
   // note: other fields of pr(0) have unspecified values
 }
 
+BOOST_AUTO_TEST_CASE(start_failed_permission_denied) {
+  // executable by root only, control process runs as root
+  const TMP script("#!/bin/sh\n");
+  boost::filesystem::permissions(script.path(), boost::filesystem::owner_all);
+  process.executable = script.path();
+  process.ownerId = uniqueOwnerId;
+  run();
+  verifyPGR(PGR::CompletionStatus::ABNORMAL_EXIT);
+  BOOST_CHECK_EQUAL(pr(0).completionStatus, PR::CompletionStatus::START_FAILED);
+}
+
+BOOST_AUTO_TEST_CASE(start_failed_unresolved) {
+  // not found in PATH, child is started by fork()
+  process.executable = boost::filesystem::unique_path();
+  run();
+  verifyPGR(PGR::CompletionStatus::ABNORMAL_EXIT);
+  BOOST_CHECK_EQUAL(pr(0).completionStatus, PR::CompletionStatus::START_FAILED);
+}
+
+BOOST_AUTO_TEST_SUITE(descriptors)
+
+BOOST_AUTO_TEST_CASE(closed) {
+  const TMP output;
+  process.executable = dir::tests::resources::source() / "open_fds.py";
+  process.descriptors.erase(0);
+  process.descriptors[1] = PG::File(output.path());
+  process.descriptors[7] = PG::FdAlias(2);
+  run();
+  verifyPGR();
+  verifyPRExit(0);
+  // nothing is inherited from control process
+  BOOST_CHECK_EQUAL(filesystem::read_data(output.path()), "1 2 7");
+}
+
+BOOST_AUTO_TEST_CASE(moved) {
+  // files opened by control process occupy required descriptors
+  const TMP output;
+  std::vector<std::unique_ptr<TMP>> files;
+  std::string fds = "1 2";
+  process.executable = dir::tests::resources::source() / "open_fds.py";
+  process.descriptors[1] = PG::File(output.path());
+  for (int fd = 3; fd < 10; ++fd) {
+    files.emplace_back(new TMP);
+    process.descriptors[fd] = PG::File(files.back()->path());
+    fds += " " + std::to_string(fd);
+  }
+  process.descriptors.erase(0);
+  run();
+  verifyPGR();
+  verifyPRExit(0);
+  BOOST_CHECK_EQUAL(filesystem::read_data(output.path()), fds);
+  for (int fd = 3; fd < 10; ++fd) {
+    BOOST_CHECK_EQUAL(filesystem::read_data(files[fd - 3]->path()),
+                      std::to_string(fd));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // descriptors
+
 BOOST_AUTO_TEST_SUITE(fd_alias)
 
 BOOST_AUTO_TEST_CASE(stderr_to_stdout) {
@@ -346,6 +566,35 @@ BOOST_AUTO_TEST_CASE(file_cache) {
   verifyPRExit(0);
 }
 
+BOOST_AUTO_TEST_CASE(oom_kill) {
+  process.executable = "/usr/bin/env";
+  // single buffer larger than limit
+  process.arguments = {"env", "dd", "if=/dev/zero", "of=/dev/null",
+                       "bs=64M", "count=1"};
+  task.processes[0].resourceLimits.memoryLimitBytes = 32 * 1024 * 1024;
+  run();
+  verifyPGR(PGR::CompletionStatus::ABNORMAL_EXIT);
+  verifyPR(0, PR::CompletionStatus::MEMORY_LIMIT_EXCEEDED);
+  BOOST_CHECK_LE(pr(0).resourceUsage.memoryUsageBytes,
+                 task.processes[0].resourceLimits.memoryLimitBytes);
+}
+
+BOOST_AUTO_TEST_CASE(peak_charge) {
+  process.executable = "/usr/bin/env";
+  TMP tmpfile;
+  // dd buffer is much smaller than written file
+  process.arguments = {"env", "dd", "if=/dev/zero",
+                       "of=" + tmpfile.path().string(), "bs=1M", "count=16"};
+  process.resourceLimits.outputLimitBytes = 32 * 1024 * 1024;
+  process.resourceLimits.memoryCharge =
+      decltype(process.resourceLimits)::MemoryCharge::PEAK;
+  run();
+  verifyPGR();
+  verifyPRExit(0);
+  // page cache of written file is charged
+  BOOST_CHECK_GE(pr(0).resourceUsage.memoryUsageBytes, 16 * 1024 * 1024);
+}
+
 BOOST_AUTO_TEST_SUITE_END()  // memory
 
 BOOST_AUTO_TEST_SUITE(security)
@@ -365,6 +614,34 @@ BOOST_AUTO_TEST_CASE(lost_child) {
   BOOST_CHECK_EQUAL(errno_, ESRCH);
 }
 
+BOOST_AUTO_TEST_CASE(forking_children) {
+  TMP tmpfile;
+  process.executable = "sh";
+  // keeps forking until it is killed, every child prints its pid
+  process.arguments = {"sh", "-c", "while :; do sleep 60 & echo $!; done"};
+  process.descriptors[1] = PG::File(tmpfile.path());
+  process.ownerId = uniqueOwnerId;
+  process.resourceLimits.numberOfProcesses = 100;
+  process.resourceLimits.realTimeLimit = sleepTime;
+  task.resourceLimits.realTimeLimit = 10 * decaSleepTime;
+  run();
+  verifyPGR(PGR::CompletionStatus::ABNORMAL_EXIT);
+  verifyPR(0, PR::CompletionStatus::REAL_TIME_LIMIT_EXCEEDED);
+  // termination time does not depend on number of children
+  BOOST_CHECK(pr(0).resourceUsage.realTimeUsage < decaSleepTime);
+  std::istringstream pids(filesystem::read_data(tmpfile.path()));
+  std::size_t children = 0;
+  pid_t pid;
+  while (pids >> pid) {
+    ++children;
+    const int ret = kill(pid, 0);
+    const int errno_ = errno;
+    BOOST_CHECK_LT(ret, 0);
+    BOOST_CHECK_EQUAL(errno_, ESRCH);
+  }
+  BOOST_CHECK_GT(children, 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()  // security
 
 BOOST_AUTO_TEST_SUITE_END()  // single
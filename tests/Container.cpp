@@ -3,11 +3,19 @@
 
 #include <yandex/contest/invoker/test/ContainerFixture.hpp>
 
+#include <yandex/contest/invoker/lxc/Error.hpp>
+
 #include <bunsan/test/filesystem/read_data.hpp>
 #include <bunsan/test/filesystem/tempdir.hpp>
 #include <bunsan/test/filesystem/tempfile.hpp>
 #include <bunsan/test/filesystem/write_data.hpp>
 
+#include <boost/algorithm/string/replace.hpp>
+
+#include <chrono>
+#include <sstream>
+#include <thread>
+
 #define CALL_CHECKPOINT(F)   \
   BOOST_TEST_CHECKPOINT(#F); \
   F;
@@ -77,6 +85,361 @@ BOOST_AUTO_TEST_CASE(mount_directory) {
   verifyOK();
 }
 
+BOOST_AUTO_TEST_CASE(reset) {
+  cfg.filesystemConfig.snapshot = true;
+  resetContainer();
+  const boost::filesystem::path file = "/some/new/file";
+  p(0, "true");
+  CALL_CHECKPOINT(pg->start());
+  verifyOK();
+  bunsan::test::filesystem::tempfile tmp;
+  cnt->filesystem().push(tmp.path, file, {0, 0}, 0644);
+  BOOST_CHECK(boost::filesystem::exists(cnt->filesystem().keepInRoot(file)));
+  CALL_CHECKPOINT(cnt->reset());
+  BOOST_CHECK(!boost::filesystem::exists(cnt->filesystem().keepInRoot(file)));
+  pg = cnt->createProcessGroup();
+  p(0, "sh", "-ce", "test -c /dev/null");
+  CALL_CHECKPOINT(pg->start());
+  verifyOK();
+}
+
 BOOST_AUTO_TEST_SUITE_END()  // single
 
+BOOST_AUTO_TEST_SUITE(persistent)
+
+BOOST_AUTO_TEST_CASE(sequential) {
+  cfg.controlProcessConfig.persistent = true;
+  cfg.filesystemConfig.snapshot = true;
+  resetContainer();
+  for (std::size_t i = 0; i < 3; ++i) {
+    if (i) pg = cnt->createProcessGroup();
+    p(0, "true");
+    CALL_CHECKPOINT(pg->start());
+    verifyOK();
+    CALL_CHECKPOINT(cnt->reset());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(stop) {
+  cfg.controlProcessConfig.persistent = true;
+  resetContainer();
+  p(0, "sleep", sleepTimeStr);
+  CALL_CHECKPOINT(pg->start());
+  CALL_CHECKPOINT(pg->stop());
+  verifySTOPPED();
+}
+
+BOOST_AUTO_TEST_CASE(destroy_running) {
+  cfg.controlProcessConfig.persistent = true;
+  cfg.filesystemConfig.snapshot = true;
+  resetContainer();
+  p(0, "sleep", "10");
+  CALL_CHECKPOINT(pg->start());
+  // destroyed process group stops its tasks, not only control process
+  p_.clear();
+  pg.reset();
+  CALL_CHECKPOINT(cnt->reset());
+  pg = cnt->createProcessGroup();
+  p(0, "true");
+  CALL_CHECKPOINT(pg->start());
+  verifyOK();
+}
+
+BOOST_AUTO_TEST_CASE(usage_reset) {
+  cfg.controlProcessConfig.persistent = true;
+  resetContainer();
+  p(0, "sh", "-c", "i=0; while [ $i -lt 100000 ]; do i=$((i + 1)); done");
+  CALL_CHECKPOINT(pg->start());
+  verifyOK();
+  const auto busyTimeUsage = p(0)->result().resourceUsage.timeUsage;
+  // control group of busy process is reused
+  pg = cnt->createProcessGroup();
+  p(0, "true");
+  CALL_CHECKPOINT(pg->start());
+  verifyOK();
+  BOOST_CHECK_LT(p(0)->result().resourceUsage.timeUsage, busyTimeUsage);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // persistent
+
+BOOST_AUTO_TEST_SUITE(api)
+
+BOOST_AUTO_TEST_CASE(sequential) {
+  cfg.lxcBackend = lxc::Backend::API;
+  resetContainer();
+  for (std::size_t i = 0; i < 2; ++i) {
+    if (i) pg = cnt->createProcessGroup();
+    p(0, "true");
+    CALL_CHECKPOINT(pg->start());
+    verifyOK();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(stop) {
+  cfg.lxcBackend = lxc::Backend::API;
+  resetContainer();
+  p(0, "sleep", sleepTimeStr);
+  CALL_CHECKPOINT(pg->start());
+  CALL_CHECKPOINT(pg->stop());
+  verifySTOPPED();
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // api
+
+BOOST_AUTO_TEST_SUITE(sandbox)
+
+BOOST_AUTO_TEST_CASE(sequential) {
+  cfg.lxcBackend = lxc::Backend::SANDBOX;
+  resetContainer();
+  for (std::size_t i = 0; i < 2; ++i) {
+    if (i) pg = cnt->createProcessGroup();
+    p(0, "true");
+    CALL_CHECKPOINT(pg->start());
+    verifyOK();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(stop) {
+  cfg.lxcBackend = lxc::Backend::SANDBOX;
+  resetContainer();
+  p(0, "sleep", sleepTimeStr);
+  CALL_CHECKPOINT(pg->start());
+  CALL_CHECKPOINT(pg->stop());
+  verifySTOPPED();
+}
+
+BOOST_AUTO_TEST_CASE(cap_drop) {
+  cfg.lxcBackend = lxc::Backend::SANDBOX;
+  cfg.lxcConfig.cap_drop = std::unordered_set<std::string>{"sys_time"};
+  resetContainer();
+  // CAP_SYS_TIME is 25
+  p(0, "sh", "-ce",
+    "test $(( 0x$(awk '/^CapBnd:/ {print $2}' /proc/self/status) "
+    ">> 25 & 1 )) = 0");
+  CALL_CHECKPOINT(pg->start());
+  verifyOK();
+}
+
+BOOST_AUTO_TEST_CASE(descriptors_not_inherited) {
+  cfg.lxcBackend = lxc::Backend::SANDBOX;
+  cfg.controlProcessConfig.persistent = true;
+  resetContainer();
+  p(0, "true");
+  CALL_CHECKPOINT(pg->start());
+  verifyOK();
+  // supervisor of another container should not keep socket of this one
+  const ya::ContainerPointer other = ya::Container::create(cfg);
+  const ya::ProcessGroupPointer otherPg = other->createProcessGroup();
+  otherPg->createProcess("true");
+  CALL_CHECKPOINT(otherPg->start());
+  BOOST_CHECK_EQUAL(otherPg->wait().completionStatus,
+                    PGR::CompletionStatus::OK);
+  // persistent control process exits when its socket is closed
+  p_.clear();
+  pg.reset();
+  CALL_CHECKPOINT(cnt.reset());
+}
+
+BOOST_AUTO_TEST_CASE(unsupported_config) {
+  cfg.lxcBackend = lxc::Backend::SANDBOX;
+  cfg.lxcConfig.console = boost::filesystem::path("/dev/tty1");
+  BOOST_CHECK_THROW(resetContainer(), ya::lxc::ConfigError);
+  cfg.lxcConfig.console = boost::none;
+  cfg.lxcConfig.cap_drop = std::unordered_set<std::string>{"no_such_cap"};
+  BOOST_CHECK_THROW(resetContainer(), ya::lxc::ConfigError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // sandbox
+
+BOOST_AUTO_TEST_SUITE(batch)
+
+BOOST_AUTO_TEST_CASE(concurrent) {
+  std::vector<ya::ProcessGroupPointer> pgs;
+  for (std::size_t i = 0; i < 5; ++i) {
+    pgs.push_back(cnt->createProcessGroup());
+    pgs.back()->createProcess(i % 2 ? "false" : "true");
+  }
+  std::size_t completed = 0;
+  CALL_CHECKPOINT(cnt->executeBatch(
+      pgs, 2, [&completed](const ya::ProcessGroupPointer &) { ++completed; }));
+  BOOST_CHECK_EQUAL(completed, pgs.size());
+  for (std::size_t i = 0; i < pgs.size(); ++i) {
+    BOOST_CHECK_EQUAL(pgs[i]->wait().completionStatus,
+                      i % 2 ? PGR::CompletionStatus::ABNORMAL_EXIT
+                            : PGR::CompletionStatus::OK);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_limits) {
+  // workers run processes in their own control groups
+  std::vector<ya::ProcessGroupPointer> pgs;
+  for (std::size_t i = 0; i < 4; ++i) {
+    pgs.push_back(cnt->createProcessGroup());
+    const ya::ProcessPointer process = pgs.back()->createProcess("sleep");
+    process->setArguments({"sleep", sleepTimeStr});
+    ya::Process::ResourceLimits resourceLimits = process->resourceLimits();
+    if (i % 2) resourceLimits.realTimeLimit = sleepTime / 4;
+    process->setResourceLimits(resourceLimits);
+  }
+  CALL_CHECKPOINT(cnt->executeBatch(pgs, 2));
+  for (std::size_t i = 0; i < pgs.size(); ++i) {
+    BOOST_CHECK_EQUAL(pgs[i]->wait().completionStatus,
+                      i % 2 ? PGR::CompletionStatus::ABNORMAL_EXIT
+                            : PGR::CompletionStatus::OK);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(failed_task) {
+  cfg.controlProcessConfig.persistent = true;
+  resetContainer();
+  std::vector<ya::ProcessGroupPointer> pgs;
+  for (std::size_t i = 0; i < 3; ++i) {
+    pgs.push_back(cnt->createProcessGroup());
+    const ya::ProcessPointer process = pgs.back()->createProcess("true");
+    // unresolved alias, control process is unable to execute the task
+    if (i == 1) process->setStream(2, ya::FdAlias(3));
+  }
+  using ControlProcessError =
+      ya::detail::execution::AsyncProcessGroupControlProcessError;
+  BOOST_CHECK_THROW(cnt->executeBatch(pgs, 2), ControlProcessError);
+  BOOST_CHECK_EQUAL(pgs[0]->wait().completionStatus,
+                    PGR::CompletionStatus::OK);
+  BOOST_CHECK_THROW(pgs[1]->wait(), ya::ProcessGroupHasNotStartedError);
+  BOOST_CHECK_EQUAL(pgs[2]->wait().completionStatus,
+                    PGR::CompletionStatus::OK);
+  // persistent control process survives failed task
+  pg = cnt->createProcessGroup();
+  p(0, "true");
+  CALL_CHECKPOINT(pg->start());
+  verifyOK();
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // batch
+
+BOOST_AUTO_TEST_SUITE(pool)
+
+namespace {
+void waitReady(const ya::ContainerPool &pool, const std::size_t ready) {
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(30);
+  while (pool.ready() < ready && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  BOOST_REQUIRE_EQUAL(pool.ready(), ready);
+}
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(reuse) {
+  const boost::filesystem::path file = "/some/new/file";
+  bunsan::test::filesystem::tempfile tmp;
+  ya::ContainerPool pool(cfg, 2);
+  waitReady(pool, 2);
+  // container creation is much slower than these calls,
+  // so pool is not refilled in between
+  const ya::ContainerPointer first = pool.acquire();
+  BOOST_REQUIRE(first);
+  BOOST_CHECK_EQUAL(pool.ready(), 1);
+  const ya::ContainerPointer second = pool.acquire();
+  BOOST_REQUIRE(second);
+  BOOST_CHECK_EQUAL(pool.ready(), 0);
+  BOOST_CHECK_NE(first, second);
+  first->filesystem().push(tmp.path, file, {0, 0}, 0644);
+  // first one is reset and returned, second one does not fit
+  pool.release(first);
+  pool.release(second);
+
+  waitReady(pool, 2);
+  ya::ContainerPointer reused;
+  for (std::size_t i = 0; i < 2; ++i) {
+    const ya::ContainerPointer container = pool.acquire();
+    BOOST_REQUIRE(container);
+    if (container == first) reused = container;
+  }
+  BOOST_REQUIRE(reused);
+  BOOST_CHECK(
+      !boost::filesystem::exists(reused->filesystem().keepInRoot(file)));
+  cnt = reused;
+  pg = cnt->createProcessGroup();
+  p(0, "true");
+  CALL_CHECKPOINT(pg->start());
+  verifyOK();
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // pool
+
+BOOST_AUTO_TEST_SUITE(cpuset)
+
+BOOST_AUTO_TEST_CASE(disjoint) {
+  bunsan::test::filesystem::tempdir locks;
+  const ya::CpuSetAllocator allocator(locks.path);
+  const std::size_t cores = allocator.cores();
+  BOOST_REQUIRE_GT(cores, 0);
+  const auto first = allocator.allocate(1);
+  if (cores > 1) {
+    const auto second = allocator.allocate(cores - 1);
+    BOOST_CHECK_NE(first->cpus(), second->cpus());
+  }
+  BOOST_CHECK_THROW(allocator.allocate(cores),
+                    ya::CpuSetAllocatorExhaustedError);
+}
+
+BOOST_AUTO_TEST_CASE(siblings) {
+  std::string siblings = bunsan::test::filesystem::read_data(
+      "/sys/devices/system/cpu/cpu0/topology/thread_siblings_list");
+  // "0-1" or "0,4"
+  boost::algorithm::replace_all(siblings, "-", " ");
+  boost::algorithm::replace_all(siblings, ",", " ");
+  std::istringstream in(siblings);
+  int first, second;
+  if (!(in >> first >> second)) {
+    BOOST_TEST_MESSAGE("CPU 0 has no hyperthread siblings.");
+    return;
+  }
+  bunsan::test::filesystem::tempdir locks;
+  const ya::CpuSetAllocator allocator(locks.path);
+  // the same physical core through different cpusets
+  const auto allocation = allocator.allocate(1, std::to_string(first));
+  BOOST_CHECK_EQUAL(allocation->cpus(), std::to_string(first));
+  BOOST_CHECK_THROW(allocator.allocate(1, std::to_string(second)),
+                    ya::CpuSetAllocatorExhaustedError);
+}
+
+BOOST_AUTO_TEST_CASE(exclusive_cores) {
+  bunsan::test::filesystem::tempdir locks;
+  cfg.cpuSetLocksDir = locks.path;
+  resetContainer();
+  ya::ProcessGroup::ResourceLimits pgrl;
+  pgrl.exclusiveCores = 1;
+  pg->setResourceLimits(pgrl);
+  p(0, "true");
+  CALL_CHECKPOINT(pg->start());
+  verifyOK();
+  // cores are released on completion
+  const ya::CpuSetAllocator allocator(locks.path);
+  BOOST_CHECK(allocator.allocate(allocator.cores()));
+}
+
+BOOST_AUTO_TEST_CASE(batch_exclusive_cores) {
+  bunsan::test::filesystem::tempdir locks;
+  cfg.cpuSetLocksDir = locks.path;
+  resetContainer();
+  const ya::CpuSetAllocator allocator(locks.path);
+  // more process groups than cores, but only one runs at once
+  std::vector<ya::ProcessGroupPointer> pgs;
+  ya::ProcessGroup::ResourceLimits pgrl;
+  pgrl.exclusiveCores = 1;
+  for (std::size_t i = 0; i <= allocator.cores(); ++i) {
+    pgs.push_back(cnt->createProcessGroup());
+    pgs.back()->setResourceLimits(pgrl);
+    pgs.back()->createProcess("true");
+  }
+  CALL_CHECKPOINT(cnt->executeBatch(pgs, 1));
+  for (const ya::ProcessGroupPointer &processGroup : pgs)
+    BOOST_CHECK_EQUAL(processGroup->wait().completionStatus,
+                      PGR::CompletionStatus::OK);
+  // cores are released when batch is completed
+  BOOST_CHECK(allocator.allocate(allocator.cores()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // cpuset
+
 BOOST_AUTO_TEST_SUITE_END()  // Container